@@ -0,0 +1,89 @@
+// Vertices per second of Skinning::skinModel, serially and on the job system,
+// for a mesh of NUM_VERTICES vertices with four influences each over a rig of
+// NUM_JOINTS joints. The shader's skinning runs on the GPU and cannot be timed
+// without a context, so the comparison is between the two CPU paths.
+
+#include <engine/animation/skinning.hpp>
+#include <engine/animation/rig.hpp>
+
+#include <engine/rendering/indexed-model.hpp>
+
+#include <engine/core/job-system.hpp>
+
+#include <engine/math/math.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+namespace {
+	constexpr const uint32 NUM_VERTICES = 200000;
+	constexpr const uint32 NUM_JOINTS = 64;
+	constexpr const uint32 NUM_ITERATIONS = 50;
+
+	template <typename Func>
+	double measure(Func&& func) {
+		const auto start = std::chrono::steady_clock::now();
+
+		for (uint32 i = 0; i < NUM_ITERATIONS; ++i) {
+			func();
+		}
+
+		return static_cast<double>(NUM_VERTICES) * NUM_ITERATIONS
+				/ std::chrono::duration<double>(std::chrono::steady_clock::now()
+				- start).count();
+	}
+}
+
+int main() {
+	Rig rig(Matrix4f(1.f));
+
+	for (uint32 i = 0; i < NUM_JOINTS; ++i) {
+		rig.addBone("joint" + std::to_string(i), Matrix4f(1.f));
+
+		const float angle = 0.1f * i;
+		Matrix4f transform(1.f);
+
+		transform[0][0] = Math::cos(angle);
+		transform[0][1] = Math::sin(angle);
+		transform[1][0] = -Math::sin(angle);
+		transform[1][1] = Math::cos(angle);
+		transform[3][0] = static_cast<float>(i);
+
+		rig.setFinalTransform(i, transform);
+	}
+
+	IndexedModel model;
+	model.initRiggedMesh();
+
+	for (uint32 v = 0; v < NUM_VERTICES; ++v) {
+		const uint32 joint = v % (NUM_JOINTS - 3);
+
+		model.addElement3f(0, 0.001f * v, 1.f, 2.f);
+		model.addElement2f(1, 0.f, 0.f);
+		model.addElement3f(2, 0.f, 1.f, 0.f);
+		model.addElement3f(3, 1.f, 0.f, 0.f);
+		model.addElement3f(4, 0.f, 0.f, 1.f);
+		model.addElementWord(5, joint | ((joint + 1) << 8) | ((joint + 2) << 16)
+				| ((joint + 3) << 24));
+		model.addElementWord(6, 128 | (64 << 8) | (48 << 16) | (15 << 24));
+	}
+
+	ArrayList<Vector3f> positions(NUM_VERTICES), normals(NUM_VERTICES);
+
+	const double serialRate = measure([&] {
+		Skinning::skinModel(model, rig, positions.data(), normals.data());
+	});
+
+	JobSystem jobSystem;
+
+	const double jobRate = measure([&] {
+		Skinning::skinModel(model, rig, positions.data(), normals.data(), jobSystem);
+	});
+
+	std::printf("%u vertices, %u joints\n", NUM_VERTICES, NUM_JOINTS);
+	std::printf("serial          %8.1f Mvertices/s\n", serialRate * 1e-6);
+	std::printf("jobs (%2u workers) %6.1f Mvertices/s\n", jobSystem.getNumWorkers(),
+			jobRate * 1e-6);
+
+	return 0;
+}
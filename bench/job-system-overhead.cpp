@@ -0,0 +1,131 @@
+// Spawn and steal overhead of JobSystem. The engine ran every system serially
+// before the job system existed, so the baselines are the same work done in a
+// plain loop and with a std::thread per batch of jobs, the cheapest fan-out
+// available without a pool.
+//
+// empty job:     run + wait of NUM_JOBS jobs that do nothing, in batches that
+//                fit one deque, ns per job
+// parallelFor:   WORK_ITEMS items of WORK_ITERATIONS iterations each at several
+//                grain sizes, ns per item
+// nested spawn:  jobs that spawn children onto their own deque, so idle
+//                workers have to steal to help, ns per leaf job
+
+#include <engine/core/job-system.hpp>
+#include <engine/core/array-list.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+namespace {
+	constexpr const uint32 NUM_JOBS = 1 << 20;
+	constexpr const uint32 BATCH_SIZE = JobSystem::MAX_JOBS_PER_WORKER;
+
+	constexpr const uint32 WORK_ITEMS = 1 << 18;
+	constexpr const uint32 WORK_ITERATIONS = 64;
+
+	constexpr const uint32 NUM_PARENTS = 256;
+	constexpr const uint32 NUM_CHILDREN = 256;
+
+	std::atomic<uint64> sink{0};
+
+	inline uint64 work(uint32 item) {
+		uint64 x = item;
+
+		for (uint32 i = 0; i < WORK_ITERATIONS; ++i) {
+			x = x * 6364136223846793005ull + 1442695040888963407ull;
+		}
+
+		return x;
+	}
+
+	void emptyJob(void*, uint32, uint32) {}
+
+	void leafJob(void*, uint32 begin, uint32) {
+		sink.fetch_add(work(begin), std::memory_order_relaxed);
+	}
+
+	void parentJob(void* data, uint32 begin, uint32) {
+		JobSystem& jobSystem = *static_cast<JobSystem*>(data);
+		JobCounter counter;
+
+		for (uint32 i = 0; i < NUM_CHILDREN; ++i) {
+			jobSystem.run(leafJob, nullptr, &counter, begin * NUM_CHILDREN + i);
+		}
+
+		jobSystem.wait(counter);
+	}
+
+	template <typename Func>
+	double measure(uint32 count, Func&& func) {
+		const auto start = std::chrono::steady_clock::now();
+		func();
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now()
+				- start).count() * 1e9 / count;
+	}
+}
+
+int main() {
+	const uint32 numThreads = std::thread::hardware_concurrency();
+	std::printf("%u hardware threads\n\n", numThreads);
+
+	JobSystem jobSystem;
+
+	const double emptyTime = measure(NUM_JOBS, [&] {
+		for (uint32 i = 0; i < NUM_JOBS; i += BATCH_SIZE) {
+			JobCounter counter;
+
+			for (uint32 j = 0; j < BATCH_SIZE; ++j) {
+				jobSystem.run(emptyJob, nullptr, &counter);
+			}
+
+			jobSystem.wait(counter);
+		}
+	});
+
+	const double threadTime = measure(NUM_JOBS / BATCH_SIZE, [&] {
+		for (uint32 i = 0; i < NUM_JOBS; i += BATCH_SIZE) {
+			std::thread thread([] {});
+			thread.join();
+		}
+	});
+
+	std::printf("empty job    %8.1f ns/job   (std::thread %.1f ns/thread)\n\n",
+			emptyTime, threadTime);
+
+	const double serialTime = measure(WORK_ITEMS, [] {
+		uint64 sum = 0;
+
+		for (uint32 i = 0; i < WORK_ITEMS; ++i) {
+			sum += work(i);
+		}
+
+		sink.fetch_add(sum, std::memory_order_relaxed);
+	});
+
+	std::printf("parallelFor  serial loop %.1f ns/item\n", serialTime);
+
+	for (uint32 grainSize : {1, 16, 256, 4096}) {
+		const double forTime = measure(WORK_ITEMS, [&] {
+			jobSystem.parallelFor(0, WORK_ITEMS, grainSize, [](uint32 i) {
+				sink.fetch_add(work(i), std::memory_order_relaxed);
+			});
+		});
+
+		std::printf("  grain %4u  %8.1f ns/item\n", grainSize, forTime);
+	}
+
+	const double nestedTime = measure(NUM_PARENTS * NUM_CHILDREN, [&] {
+		JobCounter counter;
+
+		for (uint32 i = 0; i < NUM_PARENTS; ++i) {
+			jobSystem.run(parentJob, &jobSystem, &counter, i);
+		}
+
+		jobSystem.wait(counter);
+	});
+
+	std::printf("\nnested spawn %8.1f ns/leaf job\n", nestedTime);
+
+	return 0;
+}
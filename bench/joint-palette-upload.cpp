@@ -0,0 +1,110 @@
+// Palette generation and upload for NUM_CHARACTERS rigs of NUM_JOINTS joints in
+// each JointPaletteFormat, laid out like the instanced rigged mesh path: every
+// palette is packed into one array which is then copied out whole. The copy
+// into a second buffer stands in for the buffer upload, the GL transfer itself
+// needs a context and is not measured here.
+
+#include <engine/animation/joint-palette.hpp>
+#include <engine/animation/rig.hpp>
+
+#include <engine/math/math.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+	constexpr const uint32 NUM_CHARACTERS = 1000;
+	constexpr const uint32 NUM_JOINTS = 64;
+	constexpr const uint32 NUM_FRAMES = 200;
+
+	const char* getFormatName(JointPaletteFormat format) {
+		switch (format) {
+			case JointPaletteFormat::MATRIX3X4:
+				return "3x4 matrix";
+			case JointPaletteFormat::DUAL_QUATERNION:
+				return "dual quaternion";
+			default:
+				return "4x4 matrix";
+		}
+	}
+
+	// chain of rotations and offsets, each joint relative to the previous one
+	void animate(Rig& rig, float time) {
+		Matrix4f global(1.f);
+
+		for (uint32 i = 0; i < NUM_JOINTS; ++i) {
+			const float angle = 0.1f * Math::sin(time + 0.3f * i);
+			Matrix4f local(1.f);
+
+			local[0][0] = Math::cos(angle);
+			local[0][1] = Math::sin(angle);
+			local[1][0] = -Math::sin(angle);
+			local[1][1] = Math::cos(angle);
+			local[3][1] = 0.1f;
+
+			global = global * local;
+			rig.setFinalTransform(i, global);
+		}
+	}
+}
+
+int main() {
+	ArrayList<Rig> rigs;
+	rigs.reserve(NUM_CHARACTERS);
+
+	for (uint32 c = 0; c < NUM_CHARACTERS; ++c) {
+		rigs.emplace_back(Matrix4f(1.f));
+
+		for (uint32 i = 0; i < NUM_JOINTS; ++i) {
+			rigs.back().addBone("joint" + std::to_string(i), Matrix4f(1.f));
+		}
+	}
+
+	std::printf("%u characters, %u joints, %u frames\n", NUM_CHARACTERS,
+			NUM_JOINTS, NUM_FRAMES);
+	std::printf("format            KiB/frame  animate us  pack us  copy us\n");
+
+	for (JointPaletteFormat format : {JointPaletteFormat::MATRIX4X4,
+			JointPaletteFormat::MATRIX3X4, JointPaletteFormat::DUAL_QUATERNION}) {
+		const uint32 stride = JointPalette::getStride(format);
+
+		ArrayList<Vector4f> palettes(NUM_CHARACTERS * NUM_JOINTS * stride);
+		ArrayList<Vector4f> uploadBuffer(palettes.size());
+
+		double animateTime = 0.0, packTime = 0.0, copyTime = 0.0;
+
+		for (uint32 frame = 0; frame < NUM_FRAMES; ++frame) {
+			const auto start = std::chrono::steady_clock::now();
+
+			for (uint32 c = 0; c < NUM_CHARACTERS; ++c) {
+				animate(rigs[c], 0.016f * frame + c);
+			}
+
+			const auto animated = std::chrono::steady_clock::now();
+
+			for (uint32 c = 0; c < NUM_CHARACTERS; ++c) {
+				JointPalette::pack(format, rigs[c].getTransformSet(), NUM_JOINTS,
+						&palettes[c * NUM_JOINTS * stride]);
+			}
+
+			const auto packed = std::chrono::steady_clock::now();
+
+			std::memcpy(uploadBuffer.data(), palettes.data(),
+					palettes.size() * sizeof(Vector4f));
+
+			const auto copied = std::chrono::steady_clock::now();
+
+			animateTime += std::chrono::duration<double>(animated - start).count();
+			packTime += std::chrono::duration<double>(packed - animated).count();
+			copyTime += std::chrono::duration<double>(copied - packed).count();
+		}
+
+		std::printf("%-16s  %9.0f  %10.1f  %7.1f  %7.1f\n", getFormatName(format),
+				palettes.size() * sizeof(Vector4f) / 1024.0,
+				animateTime * 1e6 / NUM_FRAMES, packTime * 1e6 / NUM_FRAMES,
+				copyTime * 1e6 / NUM_FRAMES);
+	}
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+// Lookup contention of ResourceCache against a HashMap behind one mutex.
+// Every thread does OPS / numThreads operations over NUM_IDS ids, one in
+// WRITE_INTERVAL of them a load of a new id, the rest lookups.
+
+#include <engine/resource/resource-cache.hpp>
+
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+	constexpr const uint32 NUM_IDS = 1024;
+	constexpr const uint32 OPS = 4000000;
+	constexpr const uint32 WRITE_INTERVAL = 64;
+
+	struct Resource {
+		uint32 value;
+	};
+
+	class Loader final : public ResourceLoader<Loader, Resource> {
+		public:
+			Memory::SharedPointer<Resource> load(uint32 value) const {
+				return Memory::make_shared<Resource>(Resource{value});
+			}
+	};
+
+	template <typename Func>
+	double measure(uint32 numThreads, Func&& func) {
+		ArrayList<std::thread> threads;
+		const auto start = std::chrono::steady_clock::now();
+
+		for (uint32 t = 0; t < numThreads; ++t) {
+			threads.emplace_back([&, t] {
+				uint64 sum = 0;
+
+				for (uint32 i = 0; i < OPS / numThreads; ++i) {
+					const uint32 id = (i * 7919 + t * 31) % NUM_IDS;
+
+					if (i % WRITE_INTERVAL == 0) {
+						func(NUM_IDS + t * OPS + i, true);
+					}
+					else {
+						sum += func(id, false);
+					}
+				}
+
+				volatile uint64 sink = sum;
+				(void)sink;
+			});
+		}
+
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now()
+				- start).count() * 1e9 / OPS;
+	}
+}
+
+int main() {
+	std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+	std::printf("threads  cache handle  cache acquire  single mutex  (ns/op)\n");
+
+	for (uint32 numThreads : {1, 2, 4, 8, 16}) {
+		ResourceCache<Resource> cache;
+		HashMap<uint32, Memory::SharedPointer<Resource>> map;
+		std::mutex mutex;
+
+		for (uint32 i = 0; i < NUM_IDS; ++i) {
+			cache.load<Loader>(i, i);
+			map[i] = Memory::make_shared<Resource>(Resource{i});
+		}
+
+		const double handleTime = measure(numThreads, [&](uint32 id, bool write) {
+			if (write) {
+				cache.load<Loader>(id, id);
+				return 0u;
+			}
+
+			return cache.handle(id)->value;
+		});
+
+		const double acquireTime = measure(numThreads, [&](uint32 id, bool write) {
+			if (write) {
+				cache.load<Loader>(id, id);
+				return 0u;
+			}
+
+			return cache.acquire(id)->value;
+		});
+
+		const double mutexTime = measure(numThreads, [&](uint32 id, bool write) {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (write) {
+				map[id] = Memory::make_shared<Resource>(Resource{id});
+				return 0u;
+			}
+
+			return map.find(id)->second->value;
+		});
+
+		std::printf("%7u  %12.1f  %13.1f  %12.1f\n", numThreads, handleTime,
+				acquireTime, mutexTime);
+	}
+
+	return 0;
+}
@@ -2,25 +2,233 @@
 
 #include <engine/core/array-list.hpp>
 
-#include <engine/animation/key-frame.hpp>
+#include <engine/animation/bone-track.hpp>
+
+class Rig;
 
 class Animation {
 	public:
-		inline Animation(const String& name)
-			: name(name) {}
+		// Range of keys in one channel's key arrays
+		struct Curve {
+			uint32 firstKey;
+			uint32 numKeys;
+		};
+
+		// Tolerances for dropping keys that interpolation reconstructs,
+		// rotations are compared by angle in radians
+		struct CompressionSettings {
+			float positionTolerance = 1e-3f;
+			float rotationTolerance = 1e-3f;
+			float scaleTolerance = 1e-3f;
+		};
+
+		// Sizes before and after compression and the largest difference
+		// between the compressed clip and any original key
+		struct CompressionReport {
+			size_t rawBytes;
+			size_t compressedBytes;
+
+			uint32 rawKeys;
+			uint32 compressedKeys;
+
+			float maxPositionError;
+			float maxRotationError;
+			float maxScaleError;
+		};
+
+		// dequantized value is min + q * step per component
+		struct QuantizationRange {
+			Vector3f min;
+			Vector3f step;
+		};
+
+		// Key arrays of a compressed clip and its root motion, copied out to
+		// write the clip and moved back in to restore it
+		struct CompressedKeys {
+			float timeScale = 0.f;
+			bool quantizedTimes = false; // otherwise times holds float times
+
+			ArrayList<Curve> positionCurves;
+			ArrayList<Curve> rotationCurves;
+			ArrayList<Curve> scaleCurves;
+
+			ArrayList<QuantizationRange> positionRanges;
+			ArrayList<QuantizationRange> scaleRanges;
+
+			ArrayList<uint16> quantizedPositionTimes;
+			ArrayList<uint16> quantizedRotationTimes;
+			ArrayList<uint16> quantizedScaleTimes;
+
+			ArrayList<float> positionTimes;
+			ArrayList<float> rotationTimes;
+			ArrayList<float> scaleTimes;
+
+			// 3 values per key
+			ArrayList<uint16> positions;
+			ArrayList<uint16> rotations;
+			ArrayList<uint16> scales;
+
+			int32 rootMotionBone = -1;
+
+			ArrayList<float> rootPositionTimes;
+			ArrayList<Vector3f> rootPositions;
+
+			ArrayList<float> rootRotationTimes;
+			ArrayList<Quaternion> rootRotations;
+		};
+
+		// Named marker on the clip's timeline, such as a footstep
+		struct Event {
+			float time;
+			uint32 name; // index of the name in getEventName
+		};
+
+		inline Animation(const String& name, float duration = 0.f)
+			: name(name)
+			, duration(duration)
+			, numBones(0)
+			, compressed(false)
+			, quantizedTimes(false)
+			, timeScale(0.f)
+			, rootMotionBone(-1) {}
+
+		void addTrack(BoneTrack&& track);
+
+		// Flattens the name-keyed tracks into one curve per channel per bone,
+		// ordered by the rig's bone indices, and releases them. Bones without
+		// a track are held at the identity.
+		void resolve(const Rig& rig);
+
+		inline bool isResolved() const { return numBones != 0; }
+
+		// tracks as added before resolve, one per bone after it
+		inline uint32 getNumTracks() const {
+			return isResolved() ? numBones : tracks.size();
+		}
+
+		// Copy of a track's keys for writing the clip back out. Resolved tracks
+		// are left unnamed and compressed clips return no keys.
+		BoneTrack getTrack(uint32 i) const;
+
+		// Drops keys within the tolerances of their interpolated value, then
+		// stores rotations as 48 bit smallest-three quaternions and positions,
+		// scales and key times as 16 bit values. Key times stay floats when 16
+		// bits across the clip cannot resolve its closest keys. Requires a
+		// resolved clip.
+		void compress(const CompressionSettings& settings,
+				CompressionReport* report = nullptr);
+
+		inline bool isCompressed() const { return compressed; }
+
+		// Requires a compressed clip
+		CompressedKeys getCompressedKeys() const;
+
+		// Replaces any tracks and keys by compressed keys for a rig of numBones
+		// bones. The keys are trusted, validate them when they come from a file.
+		void setCompressedKeys(uint32 numBones, CompressedKeys&& keys);
 
-		//inline Animation(const Animation& animation)
-		//	: name(animation.name)
-		//	, keyFrames(std::move(animation.keyFrames)) {}
+		// Copies the bone's position and rotation keys out as the clip's root
+		// motion, which compression leaves at full precision. Requires a
+		// resolved clip that is not compressed yet.
+		void extractRootMotion(uint32 bone);
 
-		void addKeyFrame(const KeyFrame& keyFrame);
+		inline bool hasRootMotion() const { return rootMotionBone >= 0; }
+		inline int32 getRootMotionBone() const { return rootMotionBone; }
 
-		inline KeyFrame& getKeyFrame(uint32 i) { return keyFrames[i]; }
-		inline const KeyFrame& getKeyFrame(uint32 i) const { return keyFrames[i]; }
-		inline uint32 getNumFrames() const { return keyFrames.size(); }
+		// Movement of the root from one time to a later one, relative to the
+		// root's own position and rotation at from. A to before from wraps
+		// around the end of the clip.
+		void getRootMotion(float from, float to, Vector3f& translation,
+				Quaternion& rotation) const;
+
+		// root pose at the start of the clip
+		void getRootMotionReference(Vector3f& position, Quaternion& rotation) const;
+
+		// events stay sorted by time
+		void addEvent(const String& eventName, float time);
+
+		// Events after from up to and including to, a to before from wraps
+		// around the end of the clip. The i-th of the returned number of
+		// events is getEvent((first + i) % getNumEvents()).
+		uint32 findEvents(float from, float to, uint32& first) const;
+
+		inline const Event& getEvent(uint32 i) const { return events[i]; }
+		inline const String& getEventName(const Event& event) const {
+			return eventNames[event.name];
+		}
+
+		inline uint32 getNumEvents() const { return events.size(); }
+
+		// cursor holds the key sampled last on that curve, playback that moves
+		// forward finds its key without a search
+		Vector3f samplePosition(uint32 bone, float time, uint32& cursor) const;
+		Quaternion sampleRotation(uint32 bone, float time, uint32& cursor) const;
+		Vector3f sampleScale(uint32 bone, float time, uint32& cursor) const;
+
+		inline float getDuration() const { return duration; }
+		inline uint32 getNumBones() const { return numBones; }
+
+		inline uint32 getNumKeys() const {
+			return positionTimes.size() + rotationTimes.size() + scaleTimes.size()
+					+ quantizedPositionTimes.size() + quantizedRotationTimes.size()
+					+ quantizedScaleTimes.size();
+		}
+
+		// bytes held by curves and keys
+		size_t getKeyMemoryUsage() const;
+
+		// CPU bytes of the whole clip, unresolved tracks, root motion and
+		// events included
+		uintptr getMemoryUsage() const;
 
 		inline const String& getName() const { return name; }
 	private:
 		String name;
-		ArrayList<KeyFrame> keyFrames;
+		float duration;
+
+		ArrayList<BoneTrack> tracks;
+
+		uint32 numBones;
+
+		ArrayList<Curve> positionCurves;
+		ArrayList<Curve> rotationCurves;
+		ArrayList<Curve> scaleCurves;
+
+		ArrayList<float> positionTimes;
+		ArrayList<Vector3f> positions;
+
+		ArrayList<float> rotationTimes;
+		ArrayList<Quaternion> rotations;
+
+		ArrayList<float> scaleTimes;
+		ArrayList<Vector3f> scales;
+
+		bool compressed;
+		bool quantizedTimes; // otherwise compressed keys keep their float times
+		float timeScale; // quantized time units per second
+
+		ArrayList<QuantizationRange> positionRanges;
+		ArrayList<QuantizationRange> scaleRanges;
+
+		ArrayList<uint16> quantizedPositionTimes;
+		ArrayList<uint16> quantizedPositions;
+
+		ArrayList<uint16> quantizedRotationTimes;
+		ArrayList<uint16> quantizedRotations;
+
+		ArrayList<uint16> quantizedScaleTimes;
+		ArrayList<uint16> quantizedScales;
+
+		int32 rootMotionBone;
+
+		ArrayList<float> rootPositionTimes;
+		ArrayList<Vector3f> rootPositions;
+
+		ArrayList<float> rootRotationTimes;
+		ArrayList<Quaternion> rootRotations;
+
+		ArrayList<Event> events;
+		ArrayList<String> eventNames;
+
+		void sampleRoot(float time, Vector3f& position, Quaternion& rotation) const;
 };
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/string.hpp>
+#include <engine/core/array-list.hpp>
+
+class Rig;
+
+// Per bone weight of an animation layer, indexed by the rig's bone indices
+class BoneMask {
+	public:
+		BoneMask(const Rig& rig, float weight = 0.f);
+
+		// Sets the weight of the named bone and every bone below it
+		void setBranchWeight(const Rig& rig, const String& boneName, float weight);
+
+		inline void setWeight(uint32 bone, float weight) { weights[bone] = weight; }
+
+		inline float getWeight(uint32 bone) const {
+			return bone < weights.size() ? weights[bone] : 0.f;
+		}
+
+		inline uint32 getNumBones() const { return weights.size(); }
+	private:
+		ArrayList<float> weights;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <engine/core/string.hpp>
+#include <engine/core/array-list.hpp>
+
+#include <engine/math/vector.hpp>
+#include <engine/math/quaternion.hpp>
+
+// Keys of one bone as loaded, every channel has its own key times
+struct BoneTrack {
+	inline BoneTrack(const String& boneName)
+		: boneName(boneName) {}
+
+	String boneName;
+
+	ArrayList<float> positionTimes;
+	ArrayList<Vector3f> positions;
+
+	ArrayList<float> rotationTimes;
+	ArrayList<Quaternion> rotations;
+
+	ArrayList<float> scaleTimes;
+	ArrayList<Vector3f> scales;
+};
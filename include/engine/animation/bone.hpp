@@ -2,7 +2,6 @@
 
 #include <engine/core/common.hpp>
 #include <engine/core/string.hpp>
-#include <engine/core/array-list.hpp>
 
 #include <engine/math/matrix.hpp>
 
@@ -17,7 +16,5 @@ struct Bone {
 	Matrix4f localTransform;
 	String name;
 	uint32 index;
-	uint32 parent;
-
-	ArrayList<uint32> children;
+	int32 parent;
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+
+#include <engine/math/vector.hpp>
+#include <engine/math/matrix.hpp>
+
+// Layout of the skinning matrices handed to the GPU
+enum class JointPaletteFormat {
+	MATRIX4X4, // 4 columns per joint
+	MATRIX3X4, // 3 rows per joint, the constant last row is dropped
+	DUAL_QUATERNION, // real and dual part per joint, rigid joints only
+};
+
+namespace JointPalette {
+	// number of Vector4f a single joint takes up
+	constexpr uint32 getStride(JointPaletteFormat format) {
+		switch (format) {
+			case JointPaletteFormat::MATRIX3X4:
+				return 3;
+			case JointPaletteFormat::DUAL_QUATERNION:
+				return 2;
+			default:
+				return 4;
+		}
+	}
+
+	// Writes numJoints * getStride(format) vectors to dest. Dual quaternions
+	// drop any scale in the joints, so they are only exact for rigid rigs.
+	void pack(JointPaletteFormat format, const Matrix4f* joints,
+			uint32 numJoints, Vector4f* dest);
+};
@@ -2,19 +2,22 @@
 
 #include <engine/animation/bone.hpp>
 
+#include <engine/core/array-list.hpp>
 #include <engine/core/hash-map.hpp>
 
 class Rig {
 	public:
-		static constexpr const size_t MAX_JOINTS = 20;
-		static constexpr const size_t MAX_WEIGHTS = 3;
+		// influences kept per vertex, the largest ones win
+		static constexpr const size_t MAX_WEIGHTS = 4;
 
 		inline Rig(const Matrix4f& globalInverseTransform)
-				: globalInverseTransform(globalInverseTransform)
-				, rootBone(0) {}
+				: globalInverseTransform(globalInverseTransform) {}
 
 		void resetBones();
-		void calcRootBone();
+
+		// Reorders the bones so that every parent precedes its children.
+		// remap receives the new index of each old bone index.
+		void sortBones(ArrayList<uint32>& remap);
 
 		inline bool hasBone(const String& name) const { return nameMap.find(name) != std::end(nameMap); }
 		inline void addBone(const String& name, const Matrix4f& localTransform);
@@ -23,30 +26,52 @@ class Rig {
 		inline void setFinalTransform(uint32 jointIndex, const Matrix4f& transform);
 
 		inline uint32 getBoneIndex(const String& name) { return nameMap[name]; }
+
+		// index of the named bone or -1 if the rig does not have it
+		inline int32 findBone(const String& name) const {
+			auto it = nameMap.find(name);
+			return it != std::end(nameMap) ? static_cast<int32>(it->second) : -1;
+		}
 		inline Bone& getBone(uint32 i) { return bones[i]; }
+		inline const Bone& getBone(uint32 i) const { return bones[i]; }
+
+		// parent bone index of every bone, -1 for roots
+		inline const int32* getParentIndices() const { return parentIndices.data(); }
+
+		// bones without children, such as fingers, which animation LOD may freeze
+		inline bool isLeafBone(uint32 i) const { return leafBones[i]; }
 		
 		inline size_t getNumBones() const { return bones.size(); }
-		inline Bone* getRootBone() { return &bones[rootBone]; }
 		inline const Matrix4f& getGlobalInverseTransform() const { return globalInverseTransform; }
-		inline Matrix4f* getTransformSet() { return transformSet; }
+		inline Matrix4f* getTransformSet() { return transformSet.data(); }
+		inline const Matrix4f* getTransformSet() const { return transformSet.data(); }
+
+		// CPU bytes held by the bones, their names and the transform set
+		uintptr getMemoryUsage() const;
 	private:
 		Matrix4f globalInverseTransform; // TODO: see if I really need this
-		
-		uint32 rootBone;
 
 		ArrayList<Bone> bones;
+		ArrayList<int32> parentIndices;
+		ArrayList<bool> leafBones;
 		HashMap<String, uint32> nameMap;
-		Matrix4f transformSet[MAX_JOINTS];
+		ArrayList<Matrix4f> transformSet;
 };
 
 inline void Rig::setBoneParent(const String& parent, const String& child) {
-	bones[nameMap[child]].parent = nameMap[parent];
-	bones[nameMap[parent]].children.push_back(nameMap[child]);
+	const uint32 childIndex = nameMap[child];
+
+	bones[childIndex].parent = nameMap[parent];
+	parentIndices[childIndex] = bones[childIndex].parent;
+	leafBones[bones[childIndex].parent] = false;
 }
 
 inline void Rig::addBone(const String& name, const Matrix4f& localTransform) {
 	nameMap[name] = bones.size();
 	bones.emplace_back(localTransform, name, bones.size());
+	parentIndices.push_back(-1);
+	leafBones.push_back(true);
+	transformSet.emplace_back(1.f);
 }
 
 inline void Rig::setFinalTransform(uint32 jointIndex, const Matrix4f& transform) {
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+
+#include <engine/math/vector.hpp>
+#include <engine/math/matrix.hpp>
+
+class IndexedModel;
+class Rig;
+class JobSystem;
+
+// CPU reference of the rigged mesh shader's skinning, for checking rigged
+// output without a GPU and for physics or picking against animated meshes
+namespace Skinning {
+	// Skins the positions (element 0) and normals (element 2) of vertices
+	// [firstVertex, firstVertex + numVertices) by the joint indices and weights
+	// of elements 5 and 6. Outputs are indexed by vertex, normals may be nullptr.
+	void skinVertices(const IndexedModel& model, const Matrix4f* palette,
+			uint32 firstVertex, uint32 numVertices, Vector3f* positions,
+			Vector3f* normals);
+
+	// outputs hold model.getNumVertices() vectors, normals may be nullptr
+	void skinModel(const IndexedModel& model, const Rig& rig,
+			Vector3f* positions, Vector3f* normals);
+
+	// skins grainSize vertices per job on the job system's workers
+	void skinModel(const IndexedModel& model, const Rig& rig,
+			Vector3f* positions, Vector3f* normals, JobSystem& jobSystem,
+			uint32 grainSize = 4096);
+};
@@ -1,9 +1,17 @@
 #pragma once
 
 #include <engine/core/common.hpp>
+#include <engine/core/array-list.hpp>
+#include <engine/core/frame-array.hpp>
+
+#include <engine/math/matrix.hpp>
+#include <engine/math/quaternion.hpp>
 
 class Animation;
+class BoneMask;
 class Registry;
+class Rig;
+class JobSystem;
 
 // idea: starting at the root node, go down the node tree and set the final transform
 // code:
@@ -15,10 +23,114 @@ class Registry;
 //		for each childJoint in joint.children:
 //			animateJoint(childJoint, globalTransform);
 
+struct AnimationClipState {
+    Animation* animation = nullptr;
+    float time = 0.f;
+    float previousTime = 0.f; // time before the last update, for event queries
+    float speed = 1.f;
+
+    float weight = 1.f;
+    float targetWeight = 1.f;
+    float fadeRate = 0.f; // weight per second towards targetWeight
+
+    // last key sampled on each curve, position/rotation/scale per bone
+    ArrayList<uint32> keyCursors;
+};
+
+enum class AnimationBlendMode {
+    OVERRIDE, // replaces the pose of the layers below by the layer weight
+    ADDITIVE // adds the difference of each clip from its first frame
+};
+
+// Clips of a layer are blended by their normalized weights, the result is
+// applied over the layers below with the layer weight scaled by the mask
+struct AnimationLayer {
+    static constexpr const uint32 MAX_CLIPS = 4;
+
+    AnimationClipState clips[MAX_CLIPS];
+    uint32 numClips = 0;
+
+    float weight = 1.f;
+    AnimationBlendMode blendMode = AnimationBlendMode::OVERRIDE;
+    const BoneMask* mask = nullptr;
+};
+
 struct Animator {
-    Animation* currentAnim = nullptr;
-    float animTime = 0.f;
-    uint32 frameIndex = 0;
+    static constexpr const uint32 MAX_LAYERS = 4;
+    static constexpr const uint32 NUM_LODS = 4; // every 1, 2, 4 and 8 frames
+
+    AnimationLayer layers[MAX_LAYERS];
+    uint32 numLayers = 1;
+
+    // Holds the root bone of clips with root motion at its first key and
+    // reports the movement of the base layer's clips in the rigged mesh's
+    // space instead, for gameplay to apply to the entity
+    bool applyRootMotion = false;
+    Vector3f rootMotionTranslation = Vector3f(0.f, 0.f, 0.f);
+    Quaternion rootMotionRotation = Quaternion(1.f, 0.f, 0.f, 0.f);
+
+    uint32 lod = 0;
+    bool skipLeafBones = false;
+
+    uint32 lodFrame = 0; // frames since the last evaluation
+    float lodDeltaTime = 0.f; // time not yet applied to the clips
+
+    // last two evaluated palettes while lod > 0, and the last local transform
+    // of every bone once leaf bones have been skipped
+    ArrayList<Matrix4f> lodPalettes;
+    ArrayList<Matrix4f> localTransforms;
+};
+
+// Screen size is the bounding sphere radius over the distance from the camera
+// to the sphere center
+struct AnimationLODSettings {
+    float minScreenSizes[Animator::NUM_LODS - 1] = {0.1f, 0.05f, 0.025f};
+    uint32 leafSkipLOD = 2; // NUM_LODS never skips leaf bones
+};
+
+struct AnimationLODStats {
+    uint32 numAnimators[Animator::NUM_LODS] = {};
+    uint32 numEvaluated[Animator::NUM_LODS] = {};
+    uint32 numInterpolated[Animator::NUM_LODS] = {};
+    uint32 numSkippedBones = 0;
+};
+
+// Fades anim in on the layer over fadeTime seconds while the layer's other
+// clips fade out and are removed, a fadeTime of 0 switches at once
+void playAnimation(Animator& animator, Animation* anim, uint32 layer = 0,
+        float fadeTime = 0.f);
+
+// Adds anim to the layer's blend with a fixed weight, returns nullptr if the
+// layer is full
+AnimationClipState* addAnimation(Animator& animator, Animation* anim, uint32 layer,
+        float weight);
+
+// Picks each animator's LOD from the screen size of its rigged mesh
+void updateAnimationLODs(Registry& registry, const Vector3f& cameraPosition,
+        const AnimationLODSettings& settings = AnimationLODSettings());
+
+// Writes the update's counters to stats when given
+void updateAnimators(Registry& registry, float deltaTime,
+        AnimationLODStats* stats = nullptr);
+
+// Animators gathered by the parallel update, owned by the caller so that the
+// storage is kept between frames. Updates running at the same time each need
+// their own list.
+struct AnimatorTaskList {
+    struct Task {
+        Animator* animator;
+        Rig* rig;
+    };
+
+    FrameArray<Task> tasks;
+    // counted per chunk of tasks and summed once the update is done
+    FrameArray<AnimationLODStats> chunkStats;
+
+    AnimationLODStats stats; // counters of the last update with this list
 };
 
-void updateAnimators(Registry& registry, float deltaTime);
+// Evaluates the animators in chunks of grainSize entities on the job system's
+// workers. Entities must not share a Rig; the result matches the serial update.
+void updateAnimators(Registry& registry, float deltaTime, JobSystem& jobSystem,
+		AnimatorTaskList& taskList, uint32 grainSize = 16);
+
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/array-list.hpp>
+
+#include <utility>
+
+// ArrayList for data rebuilt every frame. clear() keeps the storage, every
+// growth of the storage is counted, and capacity that has not been needed
+// for TRIM_GENERATIONS frames is given back by endFrame().
+template <typename T>
+class FrameArray {
+	public:
+		static constexpr const uint32 TRIM_GENERATIONS = 300;
+
+		inline void push_back(const T& value);
+
+		template <typename... Args>
+		inline T& emplace_back(Args&&... args);
+
+		inline void resize(size_t size);
+
+		inline void clear();
+
+		inline void swap(FrameArray& other);
+
+		void endFrame();
+
+		inline T& operator[](size_t i) { return elements[i]; }
+		inline const T& operator[](size_t i) const { return elements[i]; }
+
+		inline T* data() { return elements.data(); }
+		inline const T* data() const { return elements.data(); }
+
+		inline T* begin() { return elements.data(); }
+		inline T* end() { return elements.data() + elements.size(); }
+		inline const T* begin() const { return elements.data(); }
+		inline const T* end() const { return elements.data() + elements.size(); }
+
+		inline size_t size() const { return elements.size(); }
+		inline size_t capacity() const { return elements.capacity(); }
+		inline bool empty() const { return elements.empty(); }
+
+		inline uint32 getGeneration() const { return generation; }
+		inline uint32 getNumAllocations() const { return numAllocations; }
+	private:
+		ArrayList<T> elements;
+
+		uint32 generation = 0;
+		uint32 lastFullGeneration = 0;
+
+		size_t peakSize = 0;
+		// largest size since the last endFrame, arrays cleared or resized
+		// several times per frame only show their last size at endFrame
+		size_t frameSize = 0;
+
+		uint32 numAllocations = 0;
+};
+
+template <typename T>
+inline void FrameArray<T>::push_back(const T& value) {
+	if (elements.size() == elements.capacity()) {
+		++numAllocations;
+	}
+
+	elements.push_back(value);
+}
+
+template <typename T>
+template <typename... Args>
+inline T& FrameArray<T>::emplace_back(Args&&... args) {
+	if (elements.size() == elements.capacity()) {
+		++numAllocations;
+	}
+
+	return elements.emplace_back(std::forward<Args>(args)...);
+}
+
+template <typename T>
+inline void FrameArray<T>::resize(size_t size) {
+	if (size > elements.capacity()) {
+		++numAllocations;
+	}
+
+	if (elements.size() > frameSize) {
+		frameSize = elements.size();
+	}
+
+	elements.resize(size);
+}
+
+template <typename T>
+inline void FrameArray<T>::clear() {
+	if (elements.size() > frameSize) {
+		frameSize = elements.size();
+	}
+
+	elements.clear();
+}
+
+template <typename T>
+inline void FrameArray<T>::swap(FrameArray& other) {
+	elements.swap(other.elements);
+
+	std::swap(generation, other.generation);
+	std::swap(lastFullGeneration, other.lastFullGeneration);
+	std::swap(peakSize, other.peakSize);
+	std::swap(frameSize, other.frameSize);
+	std::swap(numAllocations, other.numAllocations);
+}
+
+template <typename T>
+void FrameArray<T>::endFrame() {
+	++generation;
+
+	if (elements.size() > frameSize) {
+		frameSize = elements.size();
+	}
+
+	if (frameSize > peakSize) {
+		peakSize = frameSize;
+	}
+
+	if (2 * frameSize >= elements.capacity()) {
+		lastFullGeneration = generation;
+		peakSize = frameSize;
+	}
+	else if (generation - lastFullGeneration >= TRIM_GENERATIONS) {
+		// more than half the storage went unused for the whole window,
+		// shrink to the largest size actually seen in that window
+		ArrayList<T> trimmed;
+		trimmed.reserve(peakSize);
+
+		elements.swap(trimmed);
+
+		lastFullGeneration = generation;
+		peakSize = 0;
+	}
+
+	frameSize = 0;
+	elements.clear();
+}
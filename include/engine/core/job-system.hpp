@@ -0,0 +1,152 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/service.hpp>
+
+#include <atomic>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Counts unfinished jobs. A job that depends on others waits on their counter,
+// which runs pending jobs on the waiting thread instead of blocking it.
+class JobCounter {
+	public:
+		inline JobCounter() : value(0) {}
+
+		inline bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+	private:
+		NULL_COPY_AND_ASSIGN(JobCounter);
+
+		std::atomic<uint32> value;
+
+		friend class JobSystem;
+};
+
+// Fixed pool of worker threads, each owning a Chase-Lev work-stealing deque.
+// The thread that creates the system is worker 0 and only does work while it
+// waits on a counter. Jobs submitted from threads outside the pool run inline.
+class JobSystem final : public Service<JobSystem> {
+	public:
+		typedef void (*JobFunction)(void* data, uint32 begin, uint32 end);
+
+		static constexpr const uint32 MAX_JOBS_PER_WORKER = 4096; // power of 2
+
+		// numThreads counts the creating thread, 0 uses every hardware thread
+		JobSystem(uint32 numThreads = 0);
+
+		void run(JobFunction function, void* data, JobCounter* counter,
+				uint32 begin = 0, uint32 end = 0);
+
+		void wait(const JobCounter& counter);
+
+		// Calls func(i) for every i in [begin, end), split into jobs of
+		// grainSize indices, and returns once all of them are done
+		template <typename Func>
+		void parallelFor(uint32 begin, uint32 end, uint32 grainSize, Func&& func);
+
+		inline uint32 getNumWorkers() const { return numWorkers; }
+
+		// Index of the calling thread's worker or (uint32)-1 outside the pool
+		uint32 getCurrentWorker() const;
+
+		~JobSystem();
+	private:
+		NULL_COPY_AND_ASSIGN(JobSystem);
+
+		struct Job {
+			JobFunction function;
+			void* data;
+			JobCounter* counter;
+			uint32 begin;
+			uint32 end;
+		};
+
+		// jobs are stored by value, a thief may read a slot while the owner
+		// overwrites it and then discards the copy when it loses the race
+		struct JobSlot {
+			std::atomic<JobFunction> function;
+			std::atomic<void*> data;
+			std::atomic<JobCounter*> counter;
+			std::atomic<uint32> begin;
+			std::atomic<uint32> end;
+		};
+
+		class JobDeque {
+			public:
+				JobDeque();
+
+				bool push(const Job& job);
+				bool take(Job& job);
+				bool steal(Job& job);
+
+				~JobDeque();
+			private:
+				alignas(64) std::atomic<int64> top;
+				alignas(64) std::atomic<int64> bottom;
+
+				JobSlot* buffer;
+
+				static void store(JobSlot& slot, const Job& job);
+				static void load(const JobSlot& slot, Job& job);
+		};
+
+		struct alignas(64) Worker {
+			JobDeque deque;
+			uint32 randomState;
+		};
+
+		Worker* workers;
+		std::thread* threads;
+		uint32 numWorkers;
+
+		std::atomic<bool> running;
+		std::atomic<uint32> numQueuedJobs;
+		std::atomic<uint32> numSleeping;
+
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+
+		void workerLoop(uint32 workerIndex);
+
+		bool executeNext(uint32 workerIndex);
+		void execute(const Job& job);
+
+		template <typename Func>
+		static void parallelForJob(void* data, uint32 begin, uint32 end);
+};
+
+template <typename Func>
+void JobSystem::parallelFor(uint32 begin, uint32 end, uint32 grainSize,
+		Func&& func) {
+	if (grainSize == 0) {
+		grainSize = 1;
+	}
+
+	if (end - begin <= grainSize || getCurrentWorker() == (uint32)-1) {
+		for (uint32 i = begin; i < end; ++i) {
+			func(i);
+		}
+
+		return;
+	}
+
+	JobCounter counter;
+
+	for (uint32 i = begin; i < end; i += grainSize) {
+		run(parallelForJob<Func>, const_cast<void*>(static_cast<const void*>(&func)),
+				&counter, i, end - i < grainSize ? end : i + grainSize);
+	}
+
+	wait(counter);
+}
+
+template <typename Func>
+void JobSystem::parallelForJob(void* data, uint32 begin, uint32 end) {
+	auto& func = *reinterpret_cast<std::remove_reference_t<Func>*>(data);
+
+	for (uint32 i = begin; i < end; ++i) {
+		func(i);
+	}
+}
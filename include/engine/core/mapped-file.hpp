@@ -0,0 +1,34 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/string-view.hpp>
+
+// Read-only view of a whole file mapped into memory. Pages are read in on
+// first access and shared with the OS file cache instead of copied.
+class MappedFile {
+	public:
+		inline MappedFile()
+				: data(nullptr)
+				, size(0)
+				, handle(nullptr) {}
+
+		bool open(const StringView& fileName);
+		void close();
+
+		inline const uint8* getData() const { return data; }
+		inline uintptr getSize() const { return size; }
+
+		inline bool isOpen() const { return data != nullptr; }
+
+		// Reads one byte of every page so later accesses do not block on I/O
+		void prefetch() const;
+
+		inline ~MappedFile() { close(); }
+	private:
+		NULL_COPY_AND_ASSIGN(MappedFile);
+
+		const uint8* data;
+		uintptr size;
+
+		void* handle; // mapping object, only used on Windows
+};
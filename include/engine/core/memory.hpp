@@ -3,6 +3,7 @@
 #include <engine/core/common.hpp>
 
 #include <memory>
+#include <utility>
 #include <cstring>
 #include <cstdlib>
 
@@ -56,12 +57,12 @@ namespace Memory {
 
 	template <typename T, typename... Args>
 	FORCEINLINE UniquePointer<T> make_unique(Args&&... args) {
-		return std::make_unique<T>(args...);
+		return std::make_unique<T>(std::forward<Args>(args)...);
 	}
 
 	template <typename T, typename... Args>
 	FORCEINLINE SharedPointer<T> make_shared(Args&&... args) {
-		return std::make_shared<T>(args...);
+		return std::make_shared<T>(std::forward<Args>(args)...);
 	}
 };
 
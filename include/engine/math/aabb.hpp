@@ -10,7 +10,7 @@ class AABB {
 				const Vector3f& maxExtents);
 		
 		AABB(const Vector3f* points, uint32 amt);
-		AABB(float* points, uint32 amt, uint32 stride = 0);
+		AABB(const float* points, uint32 amt, uint32 stride = 0);
 
 		bool intersectsRay(const Vector3f& start,
 				const Vector3f& rayDir, float& point1, float& point2) const;
@@ -54,6 +54,12 @@ class AABB {
 
 		FORCEINLINE bool operator==(const AABB& other) const;
 		FORCEINLINE bool operator!=(const AABB& other) const;
+
+		template <typename Archive>
+		void serialize(Archive& ar) {
+			ar(extents[0].x, extents[0].y, extents[0].z,
+					extents[1].x, extents[1].y, extents[1].z);
+		}
 	private:
 		Vector3f extents[2];
 };
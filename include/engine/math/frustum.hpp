@@ -0,0 +1,36 @@
+#pragma once
+
+#include <engine/math/vector.hpp>
+#include <engine/math/matrix.hpp>
+#include <engine/math/aabb.hpp>
+
+class Frustum {
+	public:
+		enum Planes {
+			PLANE_LEFT = 0,
+			PLANE_RIGHT,
+			PLANE_BOTTOM,
+			PLANE_TOP,
+			PLANE_NEAR,
+			PLANE_FAR,
+			NUM_PLANES
+		};
+
+		FORCEINLINE Frustum() {}
+		Frustum(const Matrix4f& viewProjection);
+
+		bool intersects(const AABB& aabb) const;
+
+		// Tests count boxes given in structure-of-arrays center/extent form,
+		// 8 or 4 at a time depending on the CPU, and writes the indices of the
+		// visible boxes into visibleIndices. Returns the number of visible boxes.
+		uint32 intersectsAABBs(const float* centerX, const float* centerY,
+				const float* centerZ, const float* extentX,
+				const float* extentY, const float* extentZ, uint32 count,
+				uint32* visibleIndices) const;
+
+		FORCEINLINE const Vector4f& getPlane(uint32 i) const { return planes[i]; }
+	private:
+		// xyz = inward facing normal, w = distance, normalized
+		Vector4f planes[NUM_PLANES];
+};
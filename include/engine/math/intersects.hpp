@@ -5,6 +5,20 @@
 #include <engine/math/vector.hpp>
 
 namespace Intersects {
+	// Triangles as separate coordinate streams of the first vertex and the two
+	// edges leaving it; element i of every stream belongs to triangle i
+	struct TriangleStreams {
+		const float* v0[3];
+		const float* e1[3];
+		const float* e2[3];
+	};
+
+	// Tests one ray against count triangles, 8 or 4 at a time depending on
+	// the CPU. Only hits closer than t are accepted; t is updated with the
+	// closest one. Returns the index of the triangle hit or (uint32)-1.
+	uint32 intersectTriangles(const Vector3f& pos, const Vector3f& dir,
+			const TriangleStreams& triangles, uint32 count, float& t);
+
 	static FORCEINLINE bool intersectTriangle(const Vector3f& pos,
 			const Vector3f& dir, const Vector3f& v0, const Vector3f& v1,
 			const Vector3f& v2, Vector3f& intersectPos, Vector3f& normal) {
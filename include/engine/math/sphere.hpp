@@ -0,0 +1,39 @@
+#pragma once
+
+#include <engine/math/vector.hpp>
+
+class Sphere {
+	public:
+		FORCEINLINE Sphere() {}
+		FORCEINLINE Sphere(const Vector3f& center, float radius)
+				: center(center)
+				, radius(radius) {}
+
+		Sphere(const float* points, uint32 amt, uint32 stride = 0);
+
+		FORCEINLINE bool contains(const Vector3f& point) const;
+		FORCEINLINE bool intersects(const Sphere& other) const;
+
+		FORCEINLINE const Vector3f& getCenter() const { return center; }
+		FORCEINLINE float getRadius() const { return radius; }
+
+		template <typename Archive>
+		void serialize(Archive& ar) {
+			ar(center.x, center.y, center.z, radius);
+		}
+	private:
+		Vector3f center;
+		float radius;
+};
+
+FORCEINLINE bool Sphere::contains(const Vector3f& point) const {
+	const Vector3f d = point - center;
+	return Math::dot(d, d) <= radius * radius;
+}
+
+FORCEINLINE bool Sphere::intersects(const Sphere& other) const {
+	const Vector3f d = other.center - center;
+	const float r = radius + other.radius;
+
+	return Math::dot(d, d) <= r * r;
+}
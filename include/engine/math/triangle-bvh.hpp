@@ -0,0 +1,59 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/array-list.hpp>
+
+#include <engine/math/vector.hpp>
+#include <engine/math/aabb.hpp>
+#include <engine/math/intersects.hpp>
+
+// Bounding volume hierarchy over an indexed triangle list, built with binned SAH.
+// Nodes are stored depth first in one array: an inner node's left child directly
+// follows it and the right child is referenced by index. Leaf triangles are copied
+// out in traversal order as coordinate streams, so a leaf is one contiguous run
+// that Intersects::intersectTriangles can test several triangles at a time.
+class TriangleBVH {
+	public:
+		static constexpr const uint32 MAX_LEAF_SIZE = 4;
+		static constexpr const uint32 MAX_RAYS_PER_PACKET = 32;
+
+		struct Node {
+			Vector3f minExtents;
+			uint32 offset; // first triangle for leaves, right child for inner nodes
+			Vector3f maxExtents;
+			uint32 count; // 0 for inner nodes
+		};
+
+		TriangleBVH(const float* positions, const uint32* indices,
+				uint32 numIndices);
+
+		// Returns the index of the closest triangle hit, or (uint32)-1
+		uint32 intersectRay(const Vector3f& pos, const Vector3f& dir,
+				float& t) const;
+
+		// Traverses rays as packets of up to MAX_RAYS_PER_PACKET, visiting a node
+		// once for every ray in the packet that reaches it. Writes the closest
+		// triangle for each ray into triangles, (uint32)-1 for misses.
+		void intersectRays(const Vector3f* positions, const Vector3f* directions,
+				uint32 numRays, float* ts, uint32* triangles) const;
+
+		inline const AABB getBounds() const;
+
+		inline uint32 getNumNodes() const { return nodes.size(); }
+		inline uint32 getNumTriangles() const { return triangleIDs.size(); }
+	private:
+		ArrayList<Node> nodes;
+
+		// v0, e1 and e2 as 9 streams of one float per triangle, in leaf order
+		ArrayList<float> triangleData;
+		ArrayList<uint32> triangleIDs; // original triangle index, in leaf order
+
+		Intersects::TriangleStreams getStreams(uint32 offset) const;
+
+		void intersectPacket(const Vector3f* positions, const Vector3f* directions,
+				uint32 numRays, float* ts, uint32* triangles) const;
+};
+
+inline const AABB TriangleBVH::getBounds() const {
+	return AABB(nodes[0].minExtents, nodes[0].maxExtents);
+}
@@ -9,7 +9,8 @@ class CubeMap {
 	public:
 		inline CubeMap(RenderContext& context)
 				: context(&context)
-				, textureID(0) {}
+				, textureID(0)
+				, memoryUsage(0) {}
 
 		CubeMap(RenderContext& context, Bitmap* bitmaps,
 				uint32 internalFormat = GL_RGB);
@@ -25,6 +26,10 @@ class CubeMap {
 		inline bool isCompressed() const { return compressed; }
 		inline bool hasMipMaps() const { return mipMaps; }
 
+		// GPU bytes uploaded to all six faces, assumes 4 bytes per texel for
+		// bitmap faces
+		inline uintptr getMemoryUsage() const { return memoryUsage; }
+
 		~CubeMap();
 	private:
 		NULL_COPY_AND_ASSIGN(CubeMap);
@@ -38,6 +43,8 @@ class CubeMap {
 		bool compressed;
 		bool mipMaps;
 
+		uintptr memoryUsage;
+
 		CubeMap(RenderContext&, uint32, bool, bool);
 
 		void initTexture();
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/frame-array.hpp>
+
+// Flat list of draw commands ordered by a packed 64-bit sort key.
+// Key layout, from most to least significant bits:
+// | target (4) | shader (8) | material (16) | vertex array (16) | depth (20) |
+// Fields are truncated IDs, so a collision only costs batching, never correctness;
+// consumers still compare the real resources when walking the sorted list.
+class DrawCommandBuffer {
+	public:
+		struct DrawCommand {
+			uint64 sortKey;
+			uint32 index;
+		};
+
+		static constexpr const uint32 TARGET_BITS = 4;
+		static constexpr const uint32 SHADER_BITS = 8;
+		static constexpr const uint32 MATERIAL_BITS = 16;
+		static constexpr const uint32 VERTEX_ARRAY_BITS = 16;
+		static constexpr const uint32 DEPTH_BITS = 20;
+
+		static inline uint64 makeSortKey(uint32 target, uint32 shader,
+				uint32 material, uint32 vertexArray, float depth);
+
+		inline void add(uint64 sortKey, uint32 index);
+
+		void sort();
+
+		inline void clear() { commands.clear(); }
+
+		inline void endFrame();
+
+		inline const DrawCommand* data() const { return commands.data(); }
+		inline size_t size() const { return commands.size(); }
+		inline bool empty() const { return commands.empty(); }
+
+		inline uint32 getNumAllocations() const;
+	private:
+		FrameArray<DrawCommand> commands;
+		FrameArray<DrawCommand> sortBuffer;
+};
+
+inline uint64 DrawCommandBuffer::makeSortKey(uint32 target, uint32 shader,
+		uint32 material, uint32 vertexArray, float depth) {
+	constexpr const uint32 depthMax = (1u << DEPTH_BITS) - 1;
+
+	// depth is expected to be normalized to [0, 1]
+	const uint32 depthBits = depth <= 0.f ? 0
+			: depth >= 1.f ? depthMax
+			: static_cast<uint32>(depth * static_cast<float>(depthMax));
+
+	uint64 key = target & ((1u << TARGET_BITS) - 1);
+	key = (key << SHADER_BITS) | (shader & ((1u << SHADER_BITS) - 1));
+	key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+	key = (key << VERTEX_ARRAY_BITS)
+			| (vertexArray & ((1u << VERTEX_ARRAY_BITS) - 1));
+	key = (key << DEPTH_BITS) | depthBits;
+
+	return key;
+}
+
+inline void DrawCommandBuffer::add(uint64 sortKey, uint32 index) {
+	commands.push_back({sortKey, index});
+}
+
+inline void DrawCommandBuffer::endFrame() {
+	commands.endFrame();
+	sortBuffer.endFrame();
+}
+
+inline uint32 DrawCommandBuffer::getNumAllocations() const {
+	return commands.getNumAllocations() + sortBuffer.getNumAllocations();
+}
@@ -31,6 +31,9 @@ class Font {
 
 		const Character& getCharacter(char c);
 
+		// GPU bytes of the glyph atlas and CPU bytes of the glyph metrics
+		uintptr getMemoryUsage() const;
+
 		~Font();
 	private:
 		NULL_COPY_AND_ASSIGN(Font);
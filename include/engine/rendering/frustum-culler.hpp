@@ -0,0 +1,57 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/frame-array.hpp>
+
+#include <engine/math/frustum.hpp>
+
+// Collects world space bounds for a set of candidates, tests them against the
+// camera frustum in SIMD batches and keeps the indices of the visible ones.
+// Candidates without bounds are always visible.
+class FrustumCuller {
+	public:
+		struct Stats {
+			uint32 numTested = 0;
+			uint32 numCulled = 0;
+			uint32 numVisible = 0;
+		};
+
+		void setFrustum(const Matrix4f& viewProjection);
+
+		inline void resetStats() { stats = {}; }
+
+		void add(uint32 id, const Matrix4f& transform, const AABB& localBounds);
+		void add(uint32 id, const Matrix4f& transform);
+
+		void cull();
+
+		void clear();
+
+		inline uint32 getNumVisible() const { return visible.size(); }
+
+		inline uint32 getVisibleID(uint32 i) const { return ids[visible[i]]; }
+		inline const Matrix4f& getVisibleTransform(uint32 i) const {
+			return transforms[visible[i]];
+		}
+
+		inline const Frustum& getFrustum() const { return frustum; }
+		inline const Stats& getStats() const { return stats; }
+	private:
+		Frustum frustum;
+
+		FrameArray<uint32> ids;
+		FrameArray<Matrix4f> transforms;
+
+		FrameArray<float> centerX;
+		FrameArray<float> centerY;
+		FrameArray<float> centerZ;
+		FrameArray<float> extentX;
+		FrameArray<float> extentY;
+		FrameArray<float> extentZ;
+
+		// candidate indices into ids/transforms, bounded ones first
+		FrameArray<uint32> boundedCandidates;
+		FrameArray<uint32> visible;
+
+		Stats stats;
+};
@@ -2,8 +2,40 @@
 
 #include <engine/core/common.hpp>
 #include <engine/core/array-list.hpp>
+#include <engine/core/memory.hpp>
 
 #include <engine/math/vector.hpp>
+#include <engine/math/aabb.hpp>
+#include <engine/math/sphere.hpp>
+
+class TriangleBVH;
+
+// Non-owning description of a model's arrays, taken from an IndexedModel or
+// straight from a mapped cooked file, which a VertexArray uploads as is
+struct IndexedModelView {
+	ArrayList<const float*> elements;
+	const uint32* elementSizes = nullptr;
+	const uint32* elementFormats = nullptr;
+	const uint32* indices = nullptr;
+
+	uint32 numVertices = 0;
+	uint32 numIndices = 0;
+	uint32 instancedElementStartIndex = (uint32)-1;
+	uint32 flags = 0;
+
+	AABB aabb;
+	Sphere boundingSphere;
+	bool boundsValid = false;
+
+	inline uint32 getNumInstanceComponents() const {
+		return instancedElementStartIndex == ((uint32)-1)
+				? 0 : (elements.size() - instancedElementStartIndex);
+	}
+
+	inline uint32 getNumVertexComponents() const {
+		return elements.size() - getNumInstanceComponents();
+	}
+};
 
 class IndexedModel {
 	public:
@@ -11,28 +43,70 @@ class IndexedModel {
 			FLAG_INTERLEAVED_INSTANCES = 0x1,
 		};
 
+		// Elements are stored as 32 bit words. Packed formats keep their
+		// components in the bits of those words instead of one float each.
+		enum ElementFormat {
+			FORMAT_FLOAT,
+			FORMAT_UBYTE4, // 4 integers in one word
+			FORMAT_UBYTE4_NORM, // 4 [0, 1] values in one word
+			FORMAT_USHORT4, // 4 integers in two words
+		};
+
 		struct AllocationHints {
 			ArrayList<uint32> elementSizes;
+			ArrayList<uint32> elementFormats; // all FORMAT_FLOAT if empty
 			uint32 instancedElementStartIndex = (uint32)-1;
 			uint32 flags = 0;
 		};
 
 		inline IndexedModel()
 				: instancedElementStartIndex((uint32)-1)
-				, flags(0) {}
+				, flags(0)
+				, boundsValid(false) {}
 
 		IndexedModel(const AllocationHints& hints);
 
+		// copies the viewed arrays
+		explicit IndexedModel(const IndexedModelView& view);
+
 		bool intersectsRay(const Vector3f& pos, const Vector3f& dir,
 				Vector3f& intersectPos, Vector3f& normal) const;
 
+		uint32 intersectRays(const Vector3f* positions, const Vector3f* directions,
+				uint32 numRays, Vector3f* intersectPositions, Vector3f* normals,
+				bool* intersected) const;
+
+		// shared so that queries keep the tree alive if the model is modified
+		Memory::SharedPointer<TriangleBVH> getBVH() const;
+		inline bool hasBVH() const {
+			return static_cast<bool>(std::atomic_load_explicit(&bvh,
+					std::memory_order_acquire));
+		}
+
 		float calcSubmergedVolume(const Vector3f& planePosition,
 				const Vector3f& planeNormal, Vector3f& centroidSum) const;
 
+		// scratch must hold getNumVertices() floats
+		float calcSubmergedVolume(const Vector3f& planePosition,
+				const Vector3f& planeNormal, Vector3f& centroidSum,
+				float* scratch) const;
+
+		// One plane per body, all in model space. Distances to several planes
+		// are computed in one pass over the vertices. Unlike calcSubmergedVolume
+		// the centroids are divided by the volume, bodies that are not
+		// submerged get zero for both.
+		void calcSubmergedVolumes(const Vector3f* planePositions,
+				const Vector3f* planeNormals, uint32 numBodies, float* volumes,
+				Vector3f* centroids) const;
+
 		void initStaticMesh();
-		void initRiggedMesh();
+		// joint indices take 8 bits each unless wideJointIndices is set
+		void initRiggedMesh(bool wideJointIndices = false);
+
+		void calcBounds();
 
-		inline void allocateElement(uint32 elementSize);
+		inline void allocateElement(uint32 elementSize,
+				uint32 format = FORMAT_FLOAT);
 		inline void setInstancedElementStartIndex(uint32 elementIndex);
 
 		void addElement1f(uint32 elementIndex, float e0);
@@ -41,6 +115,9 @@ class IndexedModel {
 		void addElement4f(uint32 elementIndex, float e0, float e1, float e2,
 				float e3);
 
+		// appends the raw bits of one word of a packed element
+		void addElementWord(uint32 elementIndex, uint32 word);
+
 		void setElement4f(uint32 elementIndex, uint32 arrayIndex,
 				float e0, float e1, float e2, float e3);
 
@@ -49,9 +126,19 @@ class IndexedModel {
 		void addIndices3i(uint32 i0, uint32 i1, uint32 i2);
 		void addIndices4i(uint32 i0, uint32 i1, uint32 i2, uint32 i3);
 
+		// valid until the model is modified or destroyed
+		IndexedModelView getView() const;
+
+		// CPU bytes held by the vertex and index arrays
+		uintptr getMemoryUsage() const;
+
 		inline ArrayList<const float*> getVertexData() const;
+		inline const float* getElementData(uint32 elementIndex) const {
+			return elements[elementIndex].data();
+		}
 		inline const uint32* getIndices() const;
 		inline const uint32* getElementSizes() const;
+		inline const uint32* getElementFormats() const;
 		inline uint32 getElementArraySize(uint32 elementIndex) const;
 
 		inline uint32 getNumVertexComponents() const;
@@ -62,6 +149,10 @@ class IndexedModel {
 		inline uint32 getInstancedElementStartIndex() const;
 		inline uint32 getFlags() const;
 
+		inline const AABB& getAABB() const { return aabb; }
+		inline const Sphere& getBoundingSphere() const { return boundingSphere; }
+		inline bool hasBounds() const { return boundsValid; }
+
 		inline float getElement1f(uint32 elementIndex,
 				uint32 arrayIndex) const;
 		inline Vector2f getElement2f(uint32 elementIndex,
@@ -70,13 +161,53 @@ class IndexedModel {
 				uint32 arrayIndex) const;
 		inline Vector4f getElement4f(uint32 elementIndex,
 				uint32 arrayIndex) const;
+
+		template <typename Archive>
+		void serialize(Archive& ar) {
+			ar(indices, elementSizes, elementFormats, elements,
+					instancedElementStartIndex,
+					flags, aabb, boundingSphere, boundsValid);
+		}
 	private:
 		ArrayList<uint32> indices;
 		ArrayList<uint32> elementSizes;
+		ArrayList<uint32> elementFormats;
 		ArrayList<ArrayList<float>> elements;
 
 		uint32 instancedElementStartIndex;
 		uint32 flags;
+
+		AABB aabb;
+		Sphere boundingSphere;
+		bool boundsValid;
+
+		// built on first use, shared between copies until either is modified.
+		// Only accessed through the std::atomic_* shared_ptr functions, so
+		// const queries from several threads can build it concurrently.
+		mutable Memory::SharedPointer<TriangleBVH> bvh;
+
+		// Positions or indices changed, the BVH and bounds no longer describe
+		// them. Mutators have the model to themselves, so while building
+		// without a BVH this is a plain check and store per call.
+		inline void invalidateGeometry() {
+			boundsValid = false;
+
+			if (bvh) {
+				std::atomic_store_explicit(&bvh, Memory::SharedPointer<TriangleBVH>(),
+						std::memory_order_release);
+			}
+		}
+
+		Vector3f calcTriangleNormal(uint32 triangle) const;
+
+		// up to 4 planes, the distances of plane k start at
+		// ds + k * getNumVertices()
+		void calcPlaneDistances(const Vector3f* planePositions,
+				const Vector3f* planeNormals, uint32 numPlanes, float* ds,
+				uint32* numSubmerged, uint32* sampleVerts) const;
+		float clipSubmergedVolume(const Vector3f& planeNormal, const float* ds,
+				uint32 numSubmerged, uint32 sampleVert,
+				Vector3f& centroidSum) const;
 };
 
 #include "indexed-model.inl"
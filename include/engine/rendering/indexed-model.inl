@@ -1,6 +1,7 @@
 
-inline void IndexedModel::allocateElement(uint32 elementSize) {
+inline void IndexedModel::allocateElement(uint32 elementSize, uint32 format) {
 	elementSizes.push_back(elementSize);
+	elementFormats.push_back(format);
 	elements.emplace_back();
 }
 
@@ -26,6 +27,10 @@ inline const uint32* IndexedModel::getElementSizes() const {
 	return &elementSizes[0];
 }
 
+inline const uint32* IndexedModel::getElementFormats() const {
+	return &elementFormats[0];
+}
+
 inline uint32 IndexedModel::getElementArraySize(uint32 elementIndex) const {
 	return elements[elementIndex].size();
 }
@@ -1,15 +1,28 @@
 #pragma once
 
+#include <engine/core/common.hpp>
+#include <engine/core/memory.hpp>
+
 class Texture;
 
 class Material {
 	public:
-		Texture* diffuse;
-		Texture* normalMap;
-		Texture* materialMap;
-		Texture* displacementMap;
+		inline Material()
+				: id(nextID++) {}
+
+		// strong references, so the texture cache cannot evict them from
+		// under the material
+		Memory::SharedPointer<Texture> diffuse;
+		Memory::SharedPointer<Texture> normalMap;
+		Memory::SharedPointer<Texture> materialMap;
+		Memory::SharedPointer<Texture> displacementMap;
 
 		float displacementScale;
+
+		inline uint32 getID() const { return id; }
 	private:
+		uint32 id;
+
+		static inline uint32 nextID = 0;
 };
 
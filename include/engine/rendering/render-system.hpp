@@ -4,15 +4,21 @@
 
 #include <engine/core/tree-map.hpp>
 #include <engine/core/array-list.hpp>
+#include <engine/core/frame-array.hpp>
 #include <engine/core/string-view.hpp>
 
 #include <engine/rendering/shader.hpp>
 #include <engine/rendering/render-target.hpp>
 #include <engine/rendering/camera.hpp>
+#include <engine/rendering/draw-command-buffer.hpp>
+#include <engine/rendering/frustum-culler.hpp>
 
 #include <engine/math/math.hpp>
 
+#include <engine/animation/joint-palette.hpp>
+
 class GaussianBlur;
+class ShaderStorageBuffer;
 class VertexArray;
 class Material;
 class Rig;
@@ -20,6 +26,9 @@ class Font;
 
 class RenderSystem final : public Service<RenderSystem> {
 	public:
+		// frames after which submission buffers are expected to stop growing
+		static constexpr const uint32 SUBMISSION_WARMUP_FRAMES = 120;
+
 		RenderSystem(RenderContext& context, uint32 width, uint32 height,
 				float fieldOfView, float zNear, float zFar);
 
@@ -73,6 +82,25 @@ class RenderSystem final : public Service<RenderSystem> {
 
 		inline Camera& getCamera() { return camera; }
 
+		inline FrustumCuller& getFrustumCuller() { return frustumCuller; }
+
+		bool setRiggedMeshInstancing(bool enabled);
+
+		inline bool isRiggedMeshInstancingEnabled() const {
+			return riggedMeshInstancing;
+		}
+
+		// the rigged mesh shaders read the palette in this layout
+		inline void setJointPaletteFormat(JointPaletteFormat format) {
+			jointPaletteFormat = format;
+		}
+
+		inline JointPaletteFormat getJointPaletteFormat() const {
+			return jointPaletteFormat;
+		}
+
+		uint32 getNumSubmissionAllocations() const;
+
 		~RenderSystem();
 		
 		void clear();
@@ -88,6 +116,19 @@ class RenderSystem final : public Service<RenderSystem> {
 	private:
 		NULL_COPY_AND_ASSIGN(RenderSystem);
 
+		struct StaticMeshCommand {
+			VertexArray* vertexArray;
+			Material* material;
+			Matrix4f transform;
+		};
+
+		struct RiggedMeshCommand {
+			VertexArray* vertexArray;
+			Material* material;
+			Rig* rig;
+			Matrix4f transform;
+		};
+
 		struct QuadData {
 			ArrayList<Vector4f> positionPairs;
 			ArrayList<Vector4f> scalePairs;
@@ -109,6 +150,7 @@ class RenderSystem final : public Service<RenderSystem> {
 
 		Shader staticMeshShader;
 		Shader riggedMeshShader;
+		Shader riggedMeshInstancedShader;
 
 		Shader skyboxShader;
 		Shader lightingShader;
@@ -128,6 +170,9 @@ class RenderSystem final : public Service<RenderSystem> {
 
 		GaussianBlur* bloomBlur;
 
+		ShaderStorageBuffer* jointPaletteBuffer;
+		uintptr jointPaletteBufferSize;
+
 		CubeMap* diffuseIBL;
 		CubeMap* specularIBL;
 
@@ -139,10 +184,36 @@ class RenderSystem final : public Service<RenderSystem> {
 
 		Camera camera;
 
-		TreeMap<Pair<VertexArray*, Material*>, ArrayList<Matrix4f>> staticMeshes;
-		TreeMap<Pair<VertexArray*, Material*>, ArrayList<Pair<Rig*, Matrix4f>>> riggedMeshes;
+		FrustumCuller frustumCuller;
+
+		DrawCommandBuffer staticMeshQueue;
+		FrameArray<StaticMeshCommand> staticMeshes;
+
+		DrawCommandBuffer riggedMeshQueue;
+		FrameArray<RiggedMeshCommand> riggedMeshes;
+
+		FrameArray<Vector4f> jointPalettes;
+		JointPaletteFormat jointPaletteFormat;
+
+		bool riggedMeshInstancing;
+		bool riggedMeshInstancedShaderLoaded;
+		bool paletteOverflowReported;
+
+		uint32 numFlushedFrames;
+		uint32 numSteadyAllocations;
+
+		FrameArray<Matrix4f> instanceTransforms;
+
 		TreeMap<Texture*, QuadData> textureQuads; // TODO: color, sampler?
 
+		float calcSortDepth(const Matrix4f& transform) const;
+
+		void setMaterial(Shader& shader, Material& material);
+
+		void flushRiggedMeshesInstanced();
+
+		void checkSubmissionAllocations();
+
 		void drawScreenQuad(RenderTarget&, Shader&, uint32 numInstances = 1);
 		void drawUIQuad(RenderTarget&, Shader&, uint32 numInstances = 1);
 };
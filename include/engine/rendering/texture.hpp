@@ -33,6 +33,9 @@ class Texture {
 		inline bool isCompressed() const { return compressed; }
 		inline bool hasMipMaps() const { return mipMaps; }
 
+		// Estimated GPU bytes, assumes 4 bytes per uncompressed texel
+		uintptr getMemoryUsage() const;
+
 		~Texture();
 	private:
 		NULL_COPY_AND_ASSIGN(Texture);
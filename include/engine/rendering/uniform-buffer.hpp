@@ -44,6 +44,7 @@ class UniformBuffer {
 
 		inline uint32 getID() { return bufferID; }
 		inline uint32 getBlockBinding() { return blockBinding; }
+		inline uintptr getSize() const { return size; }
 
 		inline uintptr getOffset(const String& name) { return variableOffsets[name]; }
 
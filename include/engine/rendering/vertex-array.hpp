@@ -4,9 +4,14 @@
 #include "indexed-model.hpp"
 #include "transform-feedback.hpp"
 
+#include <engine/math/aabb.hpp>
+#include <engine/math/sphere.hpp>
+
 class VertexArray {
 	public:
 		VertexArray(RenderContext& context, const IndexedModel& model, uint32 usage);
+		VertexArray(RenderContext& context, const IndexedModelView& model,
+				uint32 usage);
 		VertexArray(RenderContext& context, const IndexedModel& model,
 				VertexArray& vertexArray);
 
@@ -31,6 +36,15 @@ class VertexArray {
 
 		inline bool isIndexed() const { return indexed; }
 
+		// GPU bytes of all buffers, shared buffers included
+		inline uintptr getMemoryUsage() const;
+
+		inline void setBounds(const AABB& aabb, const Sphere& boundingSphere);
+
+		inline const AABB& getBounds() const { return aabb; }
+		inline const Sphere& getBoundingSphere() const { return boundingSphere; }
+		inline bool hasBounds() const { return boundsValid; }
+
 		~VertexArray();
 	private:
 		enum BufferOwnership {
@@ -61,16 +75,20 @@ class VertexArray {
 
 		enum BufferOwnership bufferOwnership;
 
-		void initMultiVertexMultiInstance(uint32, const float**, uint32,
-				const uint32*, bool);
-		void initMultiVertexSingleInstance(uint32, const float**, uint32,
-				const uint32*, bool);
+		AABB aabb;
+		Sphere boundingSphere;
+		bool boundsValid = false;
+
+		void initMultiVertexMultiInstance(uint32, const float* const*, uint32,
+				const uint32*, const uint32*, bool);
+		void initMultiVertexSingleInstance(uint32, const float* const*, uint32,
+				const uint32*, const uint32*, bool);
 
 		void initEmptyArrayBuffers(uint32, uint32, const uint32*);
-		void initSharedBuffers(uint32, const float**, uint32, const uint32*,
-				uint32, const uint32*, uint32, uint32, bool);
+		void initSharedBuffers(uint32, const float* const*, uint32, const uint32*,
+				const uint32*, uint32, const uint32*, uint32, uint32, bool);
 
-		void initDistributedAttribute(uint32, bool, uint32&);
+		void initDistributedAttribute(uint32, uint32, bool, uint32&);
 		void initInterleavedAttributes(uint32, uint32, const uint32*, bool, uint32&);
 };
 
@@ -78,6 +96,23 @@ inline const uint32 VertexArray::getBuffer(uint32 bufferIndex) {
 	 return buffers[bufferIndex];
 }
 
+inline void VertexArray::setBounds(const AABB& aabb,
+		const Sphere& boundingSphere) {
+	this->aabb = aabb;
+	this->boundingSphere = boundingSphere;
+	boundsValid = true;
+}
+
+inline uintptr VertexArray::getMemoryUsage() const {
+	uintptr size = 0;
+
+	for (uint32 i = 0; i < numBuffers; ++i) {
+		size += bufferSizes[i];
+	}
+
+	return size;
+}
+
 inline const uintptr VertexArray::getBufferSize(uint32 bufferIndex) const {
 	return bufferSizes[bufferIndex];
 }
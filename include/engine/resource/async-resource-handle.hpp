@@ -0,0 +1,64 @@
+#pragma once
+
+#include <engine/core/common.hpp>
+#include <engine/core/memory.hpp>
+
+#include <engine/resource/resource-fwd.hpp>
+#include <engine/resource/resource-handle.hpp>
+
+#include <atomic>
+#include <utility>
+
+// Result of ResourceCache::loadAsync. Every caller that asked for the same id
+// while it was loading shares one state, which the cache resolves on the
+// thread calling finalizeLoads.
+template <typename Resource>
+class AsyncResourceHandle {
+	public:
+		enum Status {
+			STATUS_PENDING,
+			STATUS_READY,
+			STATUS_FAILED
+		};
+
+		AsyncResourceHandle() noexcept = default;
+
+		inline bool isPending() const noexcept {
+			return getStatus() == STATUS_PENDING;
+		}
+
+		inline bool isReady() const noexcept {
+			return getStatus() == STATUS_READY;
+		}
+
+		inline bool hasFailed() const noexcept {
+			return getStatus() == STATUS_FAILED;
+		}
+
+		// Empty until the load is ready
+		ResourceHandle<Resource> get() const noexcept {
+			return isReady() ? state->handle : ResourceHandle<Resource>();
+		}
+
+		explicit operator bool() const {
+			return static_cast<bool>(state);
+		}
+	private:
+		struct State {
+			std::atomic<uint32> status{STATUS_PENDING};
+			ResourceHandle<Resource> handle;
+		};
+
+		Memory::SharedPointer<State> state;
+
+		AsyncResourceHandle(Memory::SharedPointer<State> st) noexcept
+				: state{std::move(st)} {}
+
+		inline uint32 getStatus() const noexcept {
+			return state ? state->status.load(std::memory_order_acquire)
+					: STATUS_FAILED;
+		}
+
+		friend class ResourceCache<Resource>;
+};
+
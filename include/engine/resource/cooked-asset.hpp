@@ -0,0 +1,56 @@
+#pragma once
+
+#include <engine/core/string-view.hpp>
+#include <engine/core/mapped-file.hpp>
+
+#include <engine/animation/rig.hpp>
+#include <engine/animation/animation.hpp>
+
+#include <engine/rendering/indexed-model.hpp>
+
+// Versioned binary container of the models, rigs and animations of one asset
+// file. Every array starts on an aligned boundary, so the models of a mapped
+// file are handed to VertexArray without being parsed or copied.
+namespace CookedAsset {
+	// Writes the assets the way AssetLoader::loadAssets returns them, resolved
+	// animations belong to the first rig. Compressed animations keep their
+	// quantized keys.
+	bool write(const StringView& fileName, const ArrayList<IndexedModel>& models,
+			const ArrayList<Rig>& rigs, const ArrayList<Animation>& animations);
+
+	// Offline step, imports a source file with Assimp and writes it cooked.
+	// With compression settings the resolved animations are compressed first.
+	bool cook(const StringView& sourceFileName, const StringView& cookedFileName,
+			const Animation::CompressionSettings* compression = nullptr);
+};
+
+class CookedAssetFile {
+	public:
+		inline CookedAssetFile() : header(nullptr) {}
+
+		// maps the file and checks every record against its size and version
+		bool open(const StringView& fileName);
+		void close();
+
+		inline bool isOpen() const { return header != nullptr; }
+
+		// Faults the whole file in, for loaders that map on a worker thread
+		inline void prefetch() const { file.prefetch(); }
+
+		uint32 getNumModels() const;
+
+		// the arrays point into the mapping and are valid while the file is open
+		IndexedModelView getModel(uint32 i) const;
+
+		// Rigs and animations are small and rebuilt as owning objects, appended
+		// to the lists like AssetLoader::loadAssets does
+		void loadRigsAndAnimations(ArrayList<Rig>& rigs,
+				ArrayList<Animation>& animations) const;
+	private:
+		NULL_COPY_AND_ASSIGN(CookedAssetFile);
+
+		MappedFile file;
+		const void* header;
+
+		bool validate() const;
+};
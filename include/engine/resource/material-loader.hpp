@@ -6,13 +6,16 @@
 
 class MaterialLoader final : public ResourceLoader<MaterialLoader, Material> {
 	public:
-		Memory::SharedPointer<Material> load(Texture& diffuse, Texture& normal,
-				Texture& material, Texture& depthMap, float displacementScale) const {
+		// textures come from ResourceCache::acquire
+		Memory::SharedPointer<Material> load(Memory::SharedPointer<Texture> diffuse,
+				Memory::SharedPointer<Texture> normal,
+				Memory::SharedPointer<Texture> material,
+				Memory::SharedPointer<Texture> depthMap, float displacementScale) const {
 			auto mt = Memory::make_shared<Material>();
-				mt->diffuse = &diffuse;
-				mt->normalMap = &normal;
-				mt->materialMap = &material;
-				mt->displacementMap = &depthMap;
+				mt->diffuse = std::move(diffuse);
+				mt->normalMap = std::move(normal);
+				mt->materialMap = std::move(material);
+				mt->displacementMap = std::move(depthMap);
 				mt->displacementScale = displacementScale;
 
 			return mt;
@@ -1,13 +1,67 @@
 #pragma once
 
+#include <engine/core/string.hpp>
+
 #include <engine/resource/resource-loader.hpp>
+#include <engine/resource/cooked-asset.hpp>
 
 #include <engine/rendering/indexed-model.hpp>
 
 class ModelLoader final : public ResourceLoader<ModelLoader, IndexedModel> {
 	public:
+		struct Decoded {
+			IndexedModel model;
+		};
+
 		Memory::SharedPointer<IndexedModel> load(const IndexedModel& model) const {
 			return Memory::make_shared<IndexedModel>(model);
 		}
+
+		// Takes over the model's arrays instead of copying them
+		Memory::SharedPointer<IndexedModel> load(IndexedModel&& model) const {
+			return Memory::make_shared<IndexedModel>(std::move(model));
+		}
+
+		// Model modelIndex of a cooked asset file
+		Memory::SharedPointer<IndexedModel> load(const String& fileName,
+				uint32 modelIndex = 0) const {
+			Decoded decoded;
+
+			if (!decode(decoded, fileName, modelIndex)) {
+				return nullptr;
+			}
+
+			return finalize(decoded);
+		}
+
+		bool decode(Decoded& decoded, const IndexedModel& model) const {
+			decoded.model = model;
+			return true;
+		}
+
+		// Maps and validates the file and copies the model out, safe to call
+		// from any thread
+		bool decode(Decoded& decoded, const String& fileName,
+				uint32 modelIndex = 0) const {
+			CookedAssetFile file;
+
+			if (!file.open(fileName)) {
+				return false;
+			}
+
+			if (modelIndex >= file.getNumModels()) {
+				DEBUG_LOG(LOG_ERROR, "Model", "%s has no model %u",
+						fileName.c_str(), modelIndex);
+				return false;
+			}
+
+			decoded.model = IndexedModel(file.getModel(modelIndex));
+
+			return true;
+		}
+
+		Memory::SharedPointer<IndexedModel> finalize(Decoded& decoded) const {
+			return Memory::make_shared<IndexedModel>(std::move(decoded.model));
+		}
 	private:
 };
@@ -4,72 +4,620 @@
 #include <engine/core/memory.hpp>
 
 #include <engine/core/hash-map.hpp>
+#include <engine/core/array-list.hpp>
+#include <engine/core/job-system.hpp>
+#include <engine/core/time.hpp>
 
 #include <engine/resource/resource-handle.hpp>
+#include <engine/resource/async-resource-handle.hpp>
 #include <engine/resource/resource-loader.hpp>
 #include <engine/resource/resource-fwd.hpp>
 
 #include <utility>
+#include <tuple>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <deque>
+#include <algorithm>
+#include <type_traits>
+
+struct ResourceCacheStats {
+	uintptr residentBytes;
+	uintptr memoryBudget;
+	uint64 hits;
+	uint64 misses;
+	uint64 evictions;
+};
+
+// Bytes a cached resource keeps resident, resources that hold more than
+// their own object report it through getMemoryUsage()
+template <typename Resource, typename = void>
+struct ResourceMemoryUsage {
+	static uintptr get(const Resource&) { return sizeof(Resource); }
+};
 
+template <typename Resource>
+struct ResourceMemoryUsage<Resource, std::void_t<decltype(
+		std::declval<const Resource&>().getMemoryUsage())>> {
+	static uintptr get(const Resource& resource) {
+		return sizeof(Resource) + resource.getMemoryUsage();
+	}
+};
+
+// Whether a memory budget may evict a cache's entries. The use count only
+// sees strong references, so caches of resources that other objects point at
+// through raw pointers have to disable it.
+enum class ResourceEviction {
+	ENABLED,
+	DISABLED
+};
+
+// Resources are spread over shards by id, each behind its own reader-writer
+// lock, so lookups only share a lock with writers to the same shard and
+// loaders run without holding any lock. The cache owns its resources and hands
+// out weak generational handles. With a memory budget set, entries without a
+// strong reference from acquire that were not used in the current frame are
+// evicted least recently used first whenever an insertion goes over it, so
+// holding a handle across frames requires acquiring the resource.
 template <typename Resource>
 class ResourceCache final {
 	public:
-		ResourceCache() = default;
+		static constexpr const uint32 SHARD_BITS = 4;
+		static constexpr const uint32 NUM_SHARDS = 1 << SHARD_BITS;
+
+		explicit ResourceCache(ResourceEviction eviction = ResourceEviction::ENABLED) {
+			storage->evictable = eviction == ResourceEviction::ENABLED;
+		}
+
 		ResourceCache(ResourceCache&&) = default;
 		
 		ResourceCache& operator=(ResourceCache&&) = default;
 
+		// Frees the slots so outstanding handles stop validating
+		~ResourceCache() {
+			if (storage) {
+				clear();
+			}
+		}
+
+		// Two threads missing the same id both run the loader, the first
+		// insertion wins and the other instance is dropped
 		template <typename Loader, typename... Args>
 		ResourceHandle<Resource> load(const uint32 id, Args&&... args) {
-			ResourceHandle<Resource> resource {};
-
-			if (auto it = resources.find(id); it == resources.cend()) {
-				if (auto instance = Loader{}.get(std::forward<Args>(args)...);
-						instance) {
-					resources[id] = instance;
-					resource = std::move(instance);
-				}
+			if (auto resource = handle(id); resource) {
+				return resource;
 			}
-			else {
-				resource = it->second;
+
+			auto instance = Loader{}.get(std::forward<Args>(args)...);
+
+			if (!instance) {
+				return {};
 			}
 
+			// instance stays referenced while trimming, so the new entry
+			// survives until the caller can acquire it
+			auto resource = insert(id, instance);
+			trimToBudget();
+
 			return resource;
 		}
 
+		// Returns at once with a pending handle. Decoding loaders decode on the
+		// job system and only finalize in finalizeLoads, other loaders run
+		// entirely in finalizeLoads. Called from a thread outside the job
+		// system, or without other workers, decoding loaders run entirely in
+		// finalizeLoads as well. Asking for an id that is already loading
+		// returns the same pending load.
+		template <typename Loader, typename... Args>
+		AsyncResourceHandle<Resource> loadAsync(const uint32 id,
+				JobSystem& jobSystem, Args&&... args);
+
+		// Finalizes loads on the calling thread until the deadline passes,
+		// returns how many were finalized
+		uint32 finalizeLoads(double deadline);
+
+		size_t getNumPendingLoads() const noexcept {
+			size_t numPendingLoads = 0;
+
+			for (auto& shard : storage->shards) {
+				std::shared_lock<std::shared_mutex> lock(shard.mutex);
+				numPendingLoads += shard.pendingLoads.size();
+			}
+
+			return numPendingLoads;
+		}
+
+		// 0 disables eviction, without eviction the budget is only reported
+		void setMemoryBudget(uintptr budget) {
+			storage->memoryBudget.store(budget, std::memory_order_relaxed);
+			trimToBudget();
+		}
+
+		// Evicts entries nobody else references and nobody used this frame,
+		// oldest use first, until at most targetBytes are resident. Returns the
+		// number evicted, always 0 with eviction disabled.
+		uint32 evictUnused(uintptr targetBytes = 0);
+
+		// Advances the frame lookups stamp entries with and trims entries that
+		// were pinned by last frame's use
+		void nextFrame() {
+			storage->frame.fetch_add(1, std::memory_order_relaxed);
+			trimToBudget();
+		}
+
+		ResourceCacheStats getStats() const noexcept {
+			ResourceCacheStats stats = {
+				storage->residentBytes.load(std::memory_order_relaxed),
+				storage->memoryBudget.load(std::memory_order_relaxed),
+				0, 0,
+				storage->evictions.load(std::memory_order_relaxed)
+			};
+
+			for (auto& shard : storage->shards) {
+				stats.hits += shard.hits.load(std::memory_order_relaxed);
+				stats.misses += shard.misses.load(std::memory_order_relaxed);
+			}
+
+			return stats;
+		}
+
 		template <typename Loader, typename... Args>
 		ResourceHandle<Resource> reload(const uint32 id, Args&&... args) {
 			return (discard(id),
 					load<Loader>(id, std::forward<Args>(args)...));
 		}
 
+		// Not cached, so the caller owns the result
 		template <typename Loader, typename... Args>
-		ResourceHandle<Resource> temp(Args&&... args) const {
-			return { Loader{}.get(std::forward<Args>(args)...) };
+		Memory::SharedPointer<Resource> temp(Args&&... args) const {
+			return Loader{}.get(std::forward<Args>(args)...);
 		}
 
 		ResourceHandle<Resource> handle(const uint32 id) const {
-			auto it = resources.find(id);
-			return { it == resources.end() ? nullptr : it->second };
+			ResourceHandle<Resource> resource;
+			lookup(id, [&](const Entry& entry) { resource = entry.handle; });
+
+			return resource;
+		}
+
+		// Strong reference that keeps the resource resident while held,
+		// nullptr if the handle is stale
+		Memory::SharedPointer<Resource> acquire(const uint32 id) const {
+			Memory::SharedPointer<Resource> resource;
+			lookup(id, [&](const Entry& entry) { resource = entry.resource; });
+
+			return resource;
 		}
 
-		void clear() noexcept { resources.clear(); }
+		void clear() noexcept {
+			for (auto& shard : storage->shards) {
+				std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+				for (auto& [id, entry] : shard.resources) {
+					storage->residentBytes.fetch_sub(entry.size,
+							std::memory_order_relaxed);
+					ResourceSlots<Resource>::free(entry.handle);
+				}
+
+				shard.resources.clear();
+
+				for (auto& [id, state] : shard.pendingLoads) {
+					state->status.store(AsyncResourceHandle<Resource>::STATUS_FAILED,
+							std::memory_order_release);
+				}
+
+				shard.pendingLoads.clear();
+			}
+
+			std::lock_guard<std::mutex> lock(storage->lruMutex);
+			storage->lru.clear();
+			storage->numEntries = 0;
+		}
 
 		bool contains(const uint32 id) const noexcept {
-			return (resources.find(id) != resources.cend());
+			auto& shard = getShard(id);
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+			return (shard.resources.find(id) != shard.resources.cend());
 		}
 
-		void discard(const uint32 id) const noexcept {
-			if (auto it = resources.find(id); it != resources.end()) {
-				resources.erase(it);
+		void discard(const uint32 id) noexcept {
+			auto& shard = getShard(id);
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+			if (auto it = shard.resources.find(id); it != shard.resources.end()) {
+				eraseEntry(shard, it);
+
+				lock.unlock();
+
+				std::lock_guard<std::mutex> lruLock(storage->lruMutex);
+				--storage->numEntries;
 			}
 		}
 
 		// TODO: foreach
 
-		size_t size() const noexcept { return resources.size(); }
+		size_t size() const noexcept {
+			size_t numResources = 0;
 
-		bool empty() const noexcept { return resources.empty(); }
+			for (auto& shard : storage->shards) {
+				std::shared_lock<std::shared_mutex> lock(shard.mutex);
+				numResources += shard.resources.size();
+			}
+
+			return numResources;
+		}
+
+		bool empty() const noexcept { return size() == 0; }
 	private:
-		HashMap<uint32, Memory::SharedPointer<Resource>> resources;
+		typedef typename AsyncResourceHandle<Resource>::State LoadState;
+		typedef std::function<Memory::SharedPointer<Resource>()> FinalizeFunction;
+
+		struct DecodedLoad {
+			uint32 id;
+			FinalizeFunction finalize;
+		};
+
+		// Shared with the decode jobs so they can outlive the cache
+		struct DecodedQueue {
+			std::mutex mutex;
+			std::deque<DecodedLoad> loads;
+		};
+
+		template <typename Loader, typename ArgTuple>
+		struct DecodeJob {
+			uint32 id;
+			ArgTuple args;
+			Memory::SharedPointer<DecodedQueue> queue;
+
+			static void run(void* data, uint32, uint32);
+		};
+
+		struct Entry {
+			Memory::SharedPointer<Resource> resource;
+			ResourceHandle<Resource> handle;
+			uintptr size;
+			// Frame of the last lookup
+			mutable std::atomic<uint32> lastUse;
+
+			Entry(Memory::SharedPointer<Resource> resource, uintptr size,
+						uint32 lastUse)
+					: resource(std::move(resource))
+					, handle(ResourceSlots<Resource>::allocate(this->resource.get()))
+					, size(size)
+					, lastUse(lastUse) {}
+		};
+
+		// Padded so neighbouring shard locks and counters do not share a
+		// cache line
+		struct alignas(64) Shard {
+			mutable std::shared_mutex mutex;
+			HashMap<uint32, Entry> resources;
+			HashMap<uint32, Memory::SharedPointer<LoadState>> pendingLoads;
+
+			mutable std::atomic<uint64> hits{0};
+			mutable std::atomic<uint64> misses{0};
+		};
+
+		// Position in the eviction order. Lookups only restamp the entry, the
+		// node moves to the back when eviction finds it was used since it was
+		// queued, and it is dropped when its entry is gone.
+		struct LRUNode {
+			uint32 id;
+			ResourceHandle<Resource> handle;
+			uint32 frame;
+		};
+
+		// Behind a pointer so the cache stays movable
+		struct Storage {
+			Shard shards[NUM_SHARDS];
+
+			// Only written by nextFrame, lookups read it
+			alignas(64) std::atomic<uint32> frame{0};
+
+			alignas(64) std::atomic<uintptr> residentBytes{0};
+			std::atomic<uintptr> memoryBudget{0};
+			std::atomic<uint64> evictions{0};
+
+			bool evictable = true;
+
+			std::mutex lruMutex;
+			std::deque<LRUNode> lru;
+			uint32 numEntries = 0;
+		};
+
+		Memory::UniquePointer<Storage> storage
+				= Memory::make_unique<Storage>();
+		Memory::SharedPointer<DecodedQueue> decodedLoads
+				= Memory::make_shared<DecodedQueue>();
+
+		inline Shard& getShard(const uint32 id) const noexcept {
+			// Fibonacci hashing, so sequential ids land in different shards
+			return storage->shards[(id * 2654435769u) >> (32 - SHARD_BITS)];
+		}
+
+		// Calls onHit with the entry under the shard's reader lock
+		template <typename Func>
+		void lookup(const uint32 id, Func&& onHit) const {
+			auto& shard = getShard(id);
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+			auto it = shard.resources.find(id);
+
+			if (it == shard.resources.end()) {
+				shard.misses.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			shard.hits.fetch_add(1, std::memory_order_relaxed);
+			touch(it->second);
+
+			onHit(it->second);
+		}
+
+		inline uint32 getFrame() const noexcept {
+			return storage->frame.load(std::memory_order_relaxed);
+		}
+
+		// Only writes the entry once per frame
+		inline void touch(const Entry& entry) const noexcept {
+			const uint32 frame = getFrame();
+
+			if (entry.lastUse.load(std::memory_order_relaxed) != frame) {
+				entry.lastUse.store(frame, std::memory_order_relaxed);
+			}
+		}
+
+		void trimToBudget() {
+			const uintptr budget = storage->memoryBudget.load(
+					std::memory_order_relaxed);
+
+			if (budget != 0 && storage->residentBytes.load(
+					std::memory_order_relaxed) > budget) {
+				evictUnused(budget);
+			}
+		}
+
+		// Returns the handle of the instance that ended up in the cache
+		ResourceHandle<Resource> insert(const uint32 id,
+				Memory::SharedPointer<Resource> instance) {
+			const uint32 frame = getFrame();
+			ResourceHandle<Resource> handle;
+
+			{
+				auto& shard = getShard(id);
+				std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+				const uintptr size = ResourceMemoryUsage<Resource>::get(*instance);
+				auto [it, inserted] = shard.resources.try_emplace(id,
+						std::move(instance), size, frame);
+
+				if (!inserted) {
+					touch(it->second);
+					return it->second.handle;
+				}
+
+				storage->residentBytes.fetch_add(size, std::memory_order_relaxed);
+				handle = it->second.handle;
+			}
+
+			std::lock_guard<std::mutex> lock(storage->lruMutex);
+
+			storage->lru.push_back({id, handle, frame});
+			++storage->numEntries;
+
+			// Discarded entries leave their nodes behind, drop them before
+			// they outnumber the live ones
+			if (storage->lru.size() > 2 * storage->numEntries + 64) {
+				storage->lru.erase(std::remove_if(storage->lru.begin(),
+						storage->lru.end(), [](const LRUNode& node) {
+					return !node.handle;
+				}), storage->lru.end());
+			}
+
+			return handle;
+		}
+
+		void eraseEntry(Shard& shard,
+				typename HashMap<uint32, Entry>::iterator it) {
+			storage->residentBytes.fetch_sub(it->second.size,
+					std::memory_order_relaxed);
+			ResourceSlots<Resource>::free(it->second.handle);
+			shard.resources.erase(it);
+		}
+
+		static void queueDecodedLoad(Memory::SharedPointer<DecodedQueue>& queue,
+				uint32 id, FinalizeFunction&& finalize);
 };
+
+template <typename Resource>
+template <typename Loader, typename... Args>
+inline AsyncResourceHandle<Resource> ResourceCache<Resource>::loadAsync(
+		const uint32 id, JobSystem& jobSystem, Args&&... args) {
+	typedef std::tuple<std::decay_t<Args>...> ArgTuple;
+
+	Memory::SharedPointer<LoadState> state;
+
+	{
+		auto& shard = getShard(id);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+		if (auto it = shard.resources.find(id); it != shard.resources.cend()) {
+			state = Memory::make_shared<LoadState>();
+			shard.hits.fetch_add(1, std::memory_order_relaxed);
+			touch(it->second);
+
+			state->handle = it->second.handle;
+			state->status.store(AsyncResourceHandle<Resource>::STATUS_READY,
+					std::memory_order_release);
+
+			return {std::move(state)};
+		}
+
+		if (auto it = shard.pendingLoads.find(id);
+				it != shard.pendingLoads.cend()) {
+			return {it->second};
+		}
+
+		shard.misses.fetch_add(1, std::memory_order_relaxed);
+
+		state = Memory::make_shared<LoadState>();
+		shard.pendingLoads[id] = state;
+	}
+
+	ArgTuple argTuple(std::forward<Args>(args)...);
+
+	// Worker 0 only runs jobs while it waits, so without other workers the
+	// decode would never start. Threads outside the pool would run the job
+	// inline and block the caller, their decode waits for finalizeLoads.
+	if constexpr (IsDecodingLoader<Loader>::value) {
+		if (jobSystem.getNumWorkers() > 1
+				&& jobSystem.getCurrentWorker() != (uint32)-1) {
+			jobSystem.run(DecodeJob<Loader, ArgTuple>::run,
+					new DecodeJob<Loader, ArgTuple>{id, std::move(argTuple),
+					decodedLoads}, nullptr);
+
+			return {std::move(state)};
+		}
+	}
+
+	queueDecodedLoad(decodedLoads, id, [args = std::move(argTuple)]() {
+		return std::apply([](const auto&... a) {
+			return Loader{}.get(a...);
+		}, args);
+	});
+
+	return {std::move(state)};
+}
+
+template <typename Resource>
+inline uint32 ResourceCache<Resource>::finalizeLoads(double deadline) {
+	uint32 numFinalized = 0;
+
+	while (Time::getTime() < deadline) {
+		DecodedLoad load;
+
+		{
+			std::lock_guard<std::mutex> lock(decodedLoads->mutex);
+
+			if (decodedLoads->loads.empty()) {
+				break;
+			}
+
+			load = std::move(decodedLoads->loads.front());
+			decodedLoads->loads.pop_front();
+		}
+
+		auto resource = load.finalize();
+		++numFinalized;
+
+		Memory::SharedPointer<LoadState> state;
+
+		{
+			auto& shard = getShard(load.id);
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+			auto it = shard.pendingLoads.find(load.id);
+
+			// Cleared while loading
+			if (it == shard.pendingLoads.end()) {
+				continue;
+			}
+
+			state = std::move(it->second);
+			shard.pendingLoads.erase(it);
+		}
+
+		if (resource) {
+			state->handle = insert(load.id, resource);
+			state->status.store(AsyncResourceHandle<Resource>::STATUS_READY,
+					std::memory_order_release);
+
+			trimToBudget();
+		}
+		else {
+			state->status.store(AsyncResourceHandle<Resource>::STATUS_FAILED,
+					std::memory_order_release);
+		}
+	}
+
+	return numFinalized;
+}
+
+template <typename Resource>
+inline uint32 ResourceCache<Resource>::evictUnused(uintptr targetBytes) {
+	if (!storage->evictable) {
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lruLock(storage->lruMutex);
+
+	const uint32 frame = getFrame();
+	uint32 numEvicted = 0;
+
+	// Every node is looked at once at most, requeued nodes go to the back
+	for (size_t numNodes = storage->lru.size(); numNodes > 0
+			&& storage->residentBytes.load(std::memory_order_relaxed)
+			> targetBytes; --numNodes) {
+		LRUNode node = storage->lru.front();
+		storage->lru.pop_front();
+
+		auto& shard = getShard(node.id);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+		auto it = shard.resources.find(node.id);
+
+		// Discarded, possibly reinserted with a node of its own
+		if (it == shard.resources.end() || it->second.handle != node.handle) {
+			continue;
+		}
+
+		const uint32 lastUse = it->second.lastUse.load(std::memory_order_relaxed);
+
+		// Pinned by a strong reference or by use this frame, or used since it
+		// was queued and so younger than the nodes behind it. Only the cache
+		// can hand out new references and the shard is locked, so the entry
+		// cannot gain a user after this check.
+		if (lastUse == frame || lastUse != node.frame
+				|| it->second.resource.use_count() > 1) {
+			storage->lru.push_back({node.id, node.handle, lastUse});
+		}
+		else {
+			eraseEntry(shard, it);
+			--storage->numEntries;
+
+			++numEvicted;
+		}
+	}
+
+	storage->evictions.fetch_add(numEvicted, std::memory_order_relaxed);
+
+	return numEvicted;
+}
+
+template <typename Resource>
+inline void ResourceCache<Resource>::queueDecodedLoad(
+		Memory::SharedPointer<DecodedQueue>& queue, uint32 id,
+		FinalizeFunction&& finalize) {
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	queue->loads.push_back({id, std::move(finalize)});
+}
+
+template <typename Resource>
+template <typename Loader, typename ArgTuple>
+void ResourceCache<Resource>::DecodeJob<Loader, ArgTuple>::run(void* data,
+		uint32, uint32) {
+	Memory::UniquePointer<DecodeJob> job(static_cast<DecodeJob*>(data));
+
+	auto decoded = Memory::make_shared<typename Loader::Decoded>();
+	const bool decodeSucceeded = std::apply([&](const auto&... a) {
+		return Loader{}.decode(*decoded, a...);
+	}, job->args);
+
+	queueDecodedLoad(job->queue, job->id, [decoded, decodeSucceeded]() {
+		return decodeSucceeded ? Loader{}.finalize(*decoded)
+				: Memory::SharedPointer<Resource>();
+	});
+}
@@ -6,5 +6,11 @@ class ResourceCache;
 template <typename Resource>
 class ResourceHandle;
 
+template <typename Resource>
+class AsyncResourceHandle;
+
+template <typename Resource>
+class ResourceSlots;
+
 template <typename Loader, typename Resource>
 class ResourceLoader;
@@ -2,43 +2,201 @@
 
 #include <engine/core/common.hpp>
 #include <engine/core/memory.hpp>
+#include <engine/core/array-list.hpp>
 
 #include <engine/resource/resource-fwd.hpp>
 
-#include <utility>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <cassert>
 
+// Weak, trivially copyable reference to a cached resource: an index into the
+// per-type slot table and the generation the slot had when the resource was
+// inserted. Access is validated against the slot, so a handle to a discarded
+// or evicted resource yields nullptr instead of dangling. Handles do not keep
+// resources resident, whoever needs the resource to stay loaded holds the
+// strong reference from ResourceCache::acquire.
 template <typename Resource>
 class ResourceHandle {
 	public:
 		ResourceHandle() noexcept = default;
 
-		const Resource& get() const noexcept { return *resource; }
+		// Checked access, nullptr once the resource was discarded or evicted
+		inline Resource* get() const noexcept;
 
-		Resource& get() noexcept {
-			return const_cast<Resource&>(std::as_const(*this).get());
+		// Unchecked access for holders that keep a strong reference, asserts
+		// that the handle is still valid
+		inline Resource& operator *() const noexcept { return *getValid(); }
+		inline Resource* operator->() const noexcept { return getValid(); }
+
+		explicit operator bool() const noexcept {
+			return get() != nullptr;
+		}
+
+		inline bool operator==(const ResourceHandle& other) const noexcept {
+			return index == other.index && generation == other.generation;
 		}
 
-		operator const Resource & () const noexcept { return get(); }
-		operator Resource & () noexcept { return get(); }
+		inline bool operator!=(const ResourceHandle& other) const noexcept {
+			return !(*this == other);
+		}
 
-		const Resource& operator *() const noexcept { return get(); }
-		Resource& operator *() noexcept { return get(); }
+		inline uint32 getIndex() const noexcept { return index; }
+		inline uint32 getGeneration() const noexcept { return generation; }
+	private:
+		uint32 index = 0;
+		// slots start at generation 1, so default handles never validate
+		uint32 generation = 0;
 
-		const Resource* operator->() const noexcept { return resource.get(); }
+		inline Resource* getValid() const noexcept {
+			Resource* resource = get();
+			assert(resource && "Stale or empty ResourceHandle dereferenced");
 
-		Resource* operator->() noexcept {
-			return const_cast<Resource*>(std::as_const(*this).operator->());
+			return resource;
 		}
 
-		explicit operator bool() const {
-			return static_cast<bool>(resource);
-		}
+		ResourceHandle(uint32 index, uint32 generation) noexcept
+				: index(index)
+				, generation(generation) {}
+
+		friend class ResourceSlots<Resource>;
+};
+
+// Table of live resources of one type. Slots are allocated in blocks that
+// never move and lookups read them without a lock: the generation is read
+// before and after the pointer, so a slot freed and reused in between is
+// never mistaken for the original. The lookup cannot keep the resource alive
+// though, a thread other than the one removing entries must hold a strong
+// reference for as long as it uses the pointer.
+template <typename Resource>
+class ResourceSlots final {
+	public:
+		static constexpr const uint32 BLOCK_BITS = 10;
+		static constexpr const uint32 BLOCK_SIZE = 1 << BLOCK_BITS;
+		static constexpr const uint32 MAX_BLOCKS = 1024;
+
+		// Returns an invalid handle when the table is full
+		static ResourceHandle<Resource> allocate(Resource* resource);
+
+		// Invalidates every handle to the slot
+		static void free(const ResourceHandle<Resource>& handle);
+
+		static inline Resource* get(uint32 index, uint32 generation) noexcept;
 	private:
-		Memory::SharedPointer<Resource> resource;
+		struct Slot {
+			std::atomic<Resource*> resource{nullptr};
+			std::atomic<uint32> generation{1};
+		};
+
+		struct Table {
+			std::mutex mutex;
+			std::atomic<Slot*> blocks[MAX_BLOCKS] = {};
+			uint32 numSlots = 0;
+			ArrayList<uint32> freeSlots;
+
+			~Table() {
+				for (auto& block : blocks) {
+					delete[] block.load(std::memory_order_relaxed);
+				}
+			}
+		};
+
+		static inline Table table;
+
+		static inline Slot* getSlot(uint32 index) noexcept {
+			const uint32 block = index >> BLOCK_BITS;
 
-		ResourceHandle(Memory::SharedPointer<Resource> res) noexcept
-				: resource{std::move(res)} {}
+			if (block >= MAX_BLOCKS) {
+				return nullptr;
+			}
 
-		friend class ResourceCache<Resource>;
+			Slot* slots = table.blocks[block].load(std::memory_order_acquire);
+			return slots ? &slots[index & (BLOCK_SIZE - 1)] : nullptr;
+		}
 };
 
+static_assert(sizeof(ResourceHandle<int>) == 8,
+		"ResourceHandle must stay 8 bytes");
+static_assert(std::is_trivially_copyable_v<ResourceHandle<int>>,
+		"ResourceHandle must stay trivially copyable");
+
+template <typename Resource>
+inline Resource* ResourceHandle<Resource>::get() const noexcept {
+	return ResourceSlots<Resource>::get(index, generation);
+}
+
+template <typename Resource>
+inline Resource* ResourceSlots<Resource>::get(uint32 index,
+		uint32 generation) noexcept {
+	Slot* slot = getSlot(index);
+
+	if (!slot || slot->generation.load(std::memory_order_acquire) != generation) {
+		return nullptr;
+	}
+
+	Resource* resource = slot->resource.load(std::memory_order_acquire);
+
+	// free bumps the generation before allocate publishes a new pointer, so
+	// having seen a reused slot's pointer guarantees seeing the new generation
+	if (slot->generation.load(std::memory_order_acquire) != generation) {
+		return nullptr;
+	}
+
+	return resource;
+}
+
+template <typename Resource>
+ResourceHandle<Resource> ResourceSlots<Resource>::allocate(Resource* resource) {
+	std::lock_guard<std::mutex> lock(table.mutex);
+
+	uint32 index;
+
+	if (!table.freeSlots.empty()) {
+		index = table.freeSlots.back();
+		table.freeSlots.pop_back();
+	}
+	else {
+		index = table.numSlots;
+		const uint32 block = index >> BLOCK_BITS;
+
+		if (block >= MAX_BLOCKS) {
+			DEBUG_LOG(LOG_ERROR, "Resource",
+					"Resource slot table is full (%u slots)", index);
+			return {};
+		}
+
+		if ((index & (BLOCK_SIZE - 1)) == 0) {
+			table.blocks[block].store(new Slot[BLOCK_SIZE],
+					std::memory_order_release);
+		}
+
+		++table.numSlots;
+	}
+
+	Slot& slot = *getSlot(index);
+	slot.resource.store(resource, std::memory_order_release);
+
+	return {index, slot.generation.load(std::memory_order_relaxed)};
+}
+
+template <typename Resource>
+void ResourceSlots<Resource>::free(const ResourceHandle<Resource>& handle) {
+	std::lock_guard<std::mutex> lock(table.mutex);
+
+	Slot* slot = getSlot(handle.getIndex());
+
+	if (!slot || slot->generation.load(std::memory_order_relaxed)
+			!= handle.getGeneration()) {
+		return;
+	}
+
+	slot->resource.store(nullptr, std::memory_order_release);
+
+	uint32 generation = handle.getGeneration() + 1;
+	slot->generation.store(generation == 0 ? 1 : generation,
+			std::memory_order_release);
+
+	table.freeSlots.push_back(handle.getIndex());
+}
+
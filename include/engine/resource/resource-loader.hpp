@@ -5,6 +5,8 @@
 
 #include <engine/resource/resource-fwd.hpp>
 
+#include <type_traits>
+
 template <typename Loader, typename Resource>
 class ResourceLoader {
 	public:
@@ -17,3 +19,15 @@ class ResourceLoader {
 		friend class ResourceCache<Resource>;
 };
 
+// Loaders that declare a Decoded type load in two steps:
+// bool decode(Decoded&, args...) reads and parses the file on any thread and
+// SharedPointer<Resource> finalize(Decoded&) creates the resource on the
+// render thread. ResourceCache::loadAsync runs decode on the job system when
+// called from one of its workers.
+template <typename Loader, typename = void>
+struct IsDecodingLoader : std::false_type {};
+
+template <typename Loader>
+struct IsDecodingLoader<Loader, std::void_t<typename Loader::Decoded>>
+		: std::true_type {};
+
@@ -4,6 +4,8 @@
 
 #include <engine/resource/resource-cache.hpp>
 
+#include <engine/core/array-list.hpp>
+
 class Texture;
 class CubeMap;
 class Material;
@@ -16,14 +18,75 @@ class Font;
 
 class ResourceManager final : public Service<ResourceManager> {
     public:
+        // Materials hold their textures through strong references, the
+        // renderer and the mesh and animator components point at the other
+        // resources through raw pointers, so only caches whose users acquire
+        // their resources can evict
         ResourceCache<Texture> textures;
-        ResourceCache<CubeMap> cubeMaps;
-        ResourceCache<Material> materials;
-        ResourceCache<Shader> shaders;
+        ResourceCache<CubeMap> cubeMaps{ResourceEviction::DISABLED};
+        ResourceCache<Material> materials{ResourceEviction::DISABLED};
+        ResourceCache<Shader> shaders{ResourceEviction::DISABLED};
         ResourceCache<IndexedModel> models;
-        ResourceCache<VertexArray> vertexArrays;
-        ResourceCache<Rig> rigs;
-        ResourceCache<Animation> animations;
+        ResourceCache<VertexArray> vertexArrays{ResourceEviction::DISABLED};
+        ResourceCache<Rig> rigs{ResourceEviction::DISABLED};
+        ResourceCache<Animation> animations{ResourceEviction::DISABLED};
         ResourceCache<Font> fonts;
+
+        // Finalizes asynchronous loads on the render thread for at most
+        // timeBudget seconds, returns how many were finalized
+        uint32 finalizeLoads(double timeBudget) {
+            const double deadline = Time::getTime() + timeBudget;
+
+            return textures.finalizeLoads(deadline)
+                    + cubeMaps.finalizeLoads(deadline)
+                    + materials.finalizeLoads(deadline)
+                    + shaders.finalizeLoads(deadline)
+                    + models.finalizeLoads(deadline)
+                    + vertexArrays.finalizeLoads(deadline)
+                    + rigs.finalizeLoads(deadline)
+                    + animations.finalizeLoads(deadline)
+                    + fonts.finalizeLoads(deadline);
+        }
+
+        // Call once per frame, entries used in the current frame are never
+        // evicted and over-budget caches are trimmed when it advances
+        void nextFrame() {
+            textures.nextFrame();
+            cubeMaps.nextFrame();
+            materials.nextFrame();
+            shaders.nextFrame();
+            models.nextFrame();
+            vertexArrays.nextFrame();
+            rigs.nextFrame();
+            animations.nextFrame();
+            fonts.nextFrame();
+        }
+
+        struct CacheStats {
+            const char* name;
+            ResourceCacheStats stats;
+        };
+
+        // Resident bytes, hits, misses and evictions of every cache
+        ArrayList<CacheStats> getCacheStats() const {
+            return {
+                {"textures", textures.getStats()},
+                {"cubeMaps", cubeMaps.getStats()},
+                {"materials", materials.getStats()},
+                {"shaders", shaders.getStats()},
+                {"models", models.getStats()},
+                {"vertexArrays", vertexArrays.getStats()},
+                {"rigs", rigs.getStats()},
+                {"animations", animations.getStats()},
+                {"fonts", fonts.getStats()}
+            };
+        }
+
+        // Drops every resource of the evicting caches that nobody else
+        // references, textures held by a cached material stay resident
+        uint32 evictUnused() {
+            return textures.evictUnused() + models.evictUnused()
+                    + fonts.evictUnused();
+        }
     private:
 };
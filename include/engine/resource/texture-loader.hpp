@@ -10,37 +10,54 @@
 
 class TextureLoader final : public ResourceLoader<TextureLoader, Texture> {
 	public:
+		struct Decoded {
+			DDSTexture ddsTexture;
+			Bitmap bitmap;
+			bool isDDS = false;
+		};
+
 		// TODO: std::string_view?
 		Memory::SharedPointer<Texture> load(const String& fileName) const {
-			auto& context = RenderContext::ref();
+			Decoded decoded;
+
+			if (!decode(decoded, fileName)) {
+				return nullptr;
+			}
+
+			return finalize(decoded);
+		}
 
+		// Reads and parses the file, safe to call from any thread
+		bool decode(Decoded& decoded, const String& fileName) const {
 			const String fileExtension = Util::getFileExtension(fileName).to_lower();
 
 			if (fileExtension.compare("dds") == 0) {
-				DDSTexture ddsTexture;
-
-				if (!ddsTexture.load(fileName)) {
-					return nullptr;
-				}
+				decoded.isDDS = true;
 
-				return Memory::make_shared<Texture>(context, ddsTexture);
+				return decoded.ddsTexture.load(fileName);
 			}
 			else if (fileExtension.compare("hdr") == 0) {
 				DEBUG_LOG(LOG_ERROR, "Texture",
 						"HDR Textures are not yet supported");
 
-				return nullptr;
+				return false;
 			}
 			else {
-				Bitmap bmp;
+				decoded.isDDS = false;
 
-				if (!bmp.load(fileName)) {
-					return nullptr;
-				}
+				return decoded.bitmap.load(fileName);
+			}
+		}
 
-				return Memory::make_shared<Texture>(context, bmp, GL_RGBA);
+		// Uploads the decoded texture, render thread only
+		Memory::SharedPointer<Texture> finalize(Decoded& decoded) const {
+			auto& context = RenderContext::ref();
+
+			if (decoded.isDDS) {
+				return Memory::make_shared<Texture>(context, decoded.ddsTexture);
 			}
+
+			return Memory::make_shared<Texture>(context, decoded.bitmap, GL_RGBA);
 		}
 	private:
 };
-
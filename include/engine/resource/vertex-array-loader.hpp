@@ -1,15 +1,91 @@
 #pragma once
 
+#include <engine/core/string.hpp>
+
 #include <engine/resource/resource-loader.hpp>
+#include <engine/resource/cooked-asset.hpp>
 
 #include <engine/rendering/vertex-array.hpp>
 
 class VertexArrayLoader final : public ResourceLoader<VertexArrayLoader, VertexArray> {
 	public:
+		// Holds whatever the upload reads from, a mapped cooked file is
+		// faulted in while decoding so the upload does not block on I/O
+		struct Decoded {
+			CookedAssetFile file;
+			IndexedModel model;
+			IndexedModelView view;
+			uint32 usage = GL_STATIC_DRAW;
+		};
+
 		Memory::SharedPointer<VertexArray> load(const IndexedModel& model, uint32 usage = GL_STATIC_DRAW) const {
 			auto& context = RenderContext::ref();
 
 			return Memory::make_shared<VertexArray>(context, model, usage);
 		}
+
+		Memory::SharedPointer<VertexArray> load(const IndexedModelView& model, uint32 usage = GL_STATIC_DRAW) const {
+			auto& context = RenderContext::ref();
+
+			return Memory::make_shared<VertexArray>(context, model, usage);
+		}
+
+		// Model modelIndex of a cooked asset file, uploaded straight from the
+		// mapping
+		Memory::SharedPointer<VertexArray> load(const String& fileName,
+				uint32 modelIndex = 0, uint32 usage = GL_STATIC_DRAW) const {
+			Decoded decoded;
+
+			if (!decode(decoded, fileName, modelIndex, usage)) {
+				return nullptr;
+			}
+
+			return finalize(decoded);
+		}
+
+		bool decode(Decoded& decoded, const IndexedModel& model,
+				uint32 usage = GL_STATIC_DRAW) const {
+			decoded.model = model;
+			decoded.view = decoded.model.getView();
+			decoded.usage = usage;
+
+			return true;
+		}
+
+		// The viewed arrays must outlive the load
+		bool decode(Decoded& decoded, const IndexedModelView& model,
+				uint32 usage = GL_STATIC_DRAW) const {
+			decoded.view = model;
+			decoded.usage = usage;
+
+			return true;
+		}
+
+		bool decode(Decoded& decoded, const String& fileName,
+				uint32 modelIndex = 0, uint32 usage = GL_STATIC_DRAW) const {
+			if (!decoded.file.open(fileName)) {
+				return false;
+			}
+
+			if (modelIndex >= decoded.file.getNumModels()) {
+				DEBUG_LOG(LOG_ERROR, "Vertex Array", "%s has no model %u",
+						fileName.c_str(), modelIndex);
+				return false;
+			}
+
+			decoded.file.prefetch();
+			decoded.view = decoded.file.getModel(modelIndex);
+			decoded.usage = usage;
+
+			return true;
+		}
+
+		// Uploads the decoded model, render thread only
+		Memory::SharedPointer<VertexArray> finalize(Decoded& decoded) const {
+			auto& context = RenderContext::ref();
+
+			return Memory::make_shared<VertexArray>(context, decoded.view,
+					decoded.usage);
+		}
 	private:
 };
@@ -1,11 +1,869 @@
 #include "engine/animation/animation.hpp"
 
+#include <engine/animation/rig.hpp>
+
+#include <engine/core/hash-map.hpp>
+
+#include <engine/math/math.hpp>
+
 #include <algorithm>
+#include <cfloat>
+
+#define QUANTIZED_MAX 65535.f
+#define QUANTIZED_COMPONENT_MAX 32767.f
+
+#define SQRT_2 1.41421356237f
+#define R_SQRT_2 0.70710678118f
+
+namespace {
+	template <typename T>
+	void appendCurve(ArrayList<Animation::Curve>& curves, ArrayList<float>& times,
+			ArrayList<T>& values, const ArrayList<float>& trackTimes,
+			const ArrayList<T>& trackValues);
+
+	template <typename TimeType>
+	uint32 findKey(const TimeType* times, uint32 numKeys, float time, uint32& cursor);
+
+	float vectorError(const Vector3f& a, const Vector3f& b);
+	float rotationError(const Quaternion& a, const Quaternion& b);
+
+	template <typename T, typename Interpolate, typename Error>
+	void reduceKeys(const float* times, const T* values, uint32 numKeys, float tolerance,
+			Interpolate interpolate, Error error, ArrayList<uint32>& keys);
+
+	void calcRange(const Vector3f* values, const ArrayList<uint32>& keys,
+			Vector3f& min, Vector3f& step);
+
+	void quantizeVector(const Vector3f& v, const Vector3f& min, const Vector3f& step,
+			ArrayList<uint16>& output);
+	Vector3f dequantizeVector(const uint16* q, const Vector3f& min, const Vector3f& step);
+
+	void quantizeRotation(const Quaternion& rotation, ArrayList<uint16>& output);
+	Quaternion dequantizeRotation(const uint16* q);
+
+	template <typename TimeType>
+	Vector3f sampleQuantizedVector(const TimeType* times, const uint16* values,
+			uint32 numKeys, const Vector3f& min, const Vector3f& step,
+			float time, uint32& cursor);
+	template <typename TimeType>
+	Quaternion sampleQuantizedRotation(const TimeType* times, const uint16* values,
+			uint32 numKeys, float time, uint32& cursor);
+
+	void appendRootMotion(Vector3f& translation, Quaternion& rotation,
+			const Vector3f& startPosition, const Quaternion& startRotation,
+			const Vector3f& endPosition, const Quaternion& endRotation);
+};
+
+void Animation::addTrack(BoneTrack&& track) {
+	tracks.push_back(std::move(track));
+}
+
+void Animation::resolve(const Rig& rig) {
+	static const BoneTrack emptyTrack("");
+
+	numBones = rig.getNumBones();
+
+	HashMap<String, uint32> trackIndices;
+
+	for (uint32 i = 0; i < tracks.size(); ++i) {
+		trackIndices[tracks[i].boneName] = i;
+	}
+
+	positionCurves.clear();
+	rotationCurves.clear();
+	scaleCurves.clear();
+
+	positionTimes.clear();
+	positions.clear();
+	rotationTimes.clear();
+	rotations.clear();
+	scaleTimes.clear();
+	scales.clear();
+
+	for (uint32 i = 0; i < numBones; ++i) {
+		auto it = trackIndices.find(rig.getBone(i).name);
+		const BoneTrack& track = it != std::end(trackIndices)
+				? tracks[it->second] : emptyTrack;
+
+		::appendCurve(positionCurves, positionTimes, positions,
+				track.positionTimes, track.positions);
+		::appendCurve(rotationCurves, rotationTimes, rotations,
+				track.rotationTimes, track.rotations);
+		::appendCurve(scaleCurves, scaleTimes, scales,
+				track.scaleTimes, track.scales);
+	}
+
+	ArrayList<BoneTrack>().swap(tracks);
+}
+
+BoneTrack Animation::getTrack(uint32 i) const {
+	if (!isResolved()) {
+		return tracks[i];
+	}
+
+	BoneTrack track("");
+
+	if (compressed) {
+		return track;
+	}
+
+	const Curve& positionCurve = positionCurves[i];
+	const Curve& rotationCurve = rotationCurves[i];
+	const Curve& scaleCurve = scaleCurves[i];
+
+	track.positionTimes.assign(positionTimes.begin() + positionCurve.firstKey,
+			positionTimes.begin() + positionCurve.firstKey + positionCurve.numKeys);
+	track.positions.assign(positions.begin() + positionCurve.firstKey,
+			positions.begin() + positionCurve.firstKey + positionCurve.numKeys);
+
+	track.rotationTimes.assign(rotationTimes.begin() + rotationCurve.firstKey,
+			rotationTimes.begin() + rotationCurve.firstKey + rotationCurve.numKeys);
+	track.rotations.assign(rotations.begin() + rotationCurve.firstKey,
+			rotations.begin() + rotationCurve.firstKey + rotationCurve.numKeys);
+
+	track.scaleTimes.assign(scaleTimes.begin() + scaleCurve.firstKey,
+			scaleTimes.begin() + scaleCurve.firstKey + scaleCurve.numKeys);
+	track.scales.assign(scales.begin() + scaleCurve.firstKey,
+			scales.begin() + scaleCurve.firstKey + scaleCurve.numKeys);
+
+	return track;
+}
+
+void Animation::compress(const CompressionSettings& settings,
+		CompressionReport* report) {
+	if (compressed || !isResolved()) {
+		return;
+	}
+
+	const size_t rawBytes = getKeyMemoryUsage();
+	const uint32 rawKeys = getNumKeys();
+
+	float endTime = duration;
+
+	for (const ArrayList<float>* times : {&positionTimes, &rotationTimes, &scaleTimes}) {
+		for (float time : *times) {
+			endTime = Math::max(endTime, time);
+		}
+	}
+
+	// 16 bit times span the whole clip, so keep float times once a quantized
+	// step exceeds half the closest key spacing and keys would collapse
+	float minKeyInterval = FLT_MAX;
+
+	const auto findMinKeyInterval = [&](const ArrayList<Curve>& curves,
+			const ArrayList<float>& times) {
+		for (const Curve& curve : curves) {
+			for (uint32 i = curve.firstKey + 1, end = curve.firstKey + curve.numKeys;
+					i < end; ++i) {
+				const float interval = times[i] - times[i - 1];
+
+				if (interval > 0.f) {
+					minKeyInterval = Math::min(minKeyInterval, interval);
+				}
+			}
+		}
+	};
+
+	findMinKeyInterval(positionCurves, positionTimes);
+	findMinKeyInterval(rotationCurves, rotationTimes);
+	findMinKeyInterval(scaleCurves, scaleTimes);
+
+	quantizedTimes = endTime / QUANTIZED_MAX <= 0.5f * minKeyInterval;
+	timeScale = quantizedTimes && endTime > 0.f ? QUANTIZED_MAX / endTime : 1.f;
+
+	const auto mixVectors = [](const Vector3f& a, const Vector3f& b, float amt) {
+		return Math::mix(a, b, amt);
+	};
+
+	const auto mixRotations = [](const Quaternion& a, const Quaternion& b, float amt) {
+		return Math::slerp(a, b, amt);
+	};
+
+	ArrayList<float> keptPositionTimes, keptRotationTimes, keptScaleTimes;
+
+	const auto addTime = [&](float time, ArrayList<uint16>& quantized,
+			ArrayList<float>& kept) {
+		if (quantizedTimes) {
+			quantized.push_back(static_cast<uint16>(Math::clamp(time * timeScale + 0.5f,
+					0.f, QUANTIZED_MAX)));
+		}
+		else {
+			kept.push_back(time);
+		}
+	};
+
+	ArrayList<Curve> rawPositionCurves, rawRotationCurves, rawScaleCurves;
+	ArrayList<uint32> keys;
+
+	rawPositionCurves.swap(positionCurves);
+	rawRotationCurves.swap(rotationCurves);
+	rawScaleCurves.swap(scaleCurves);
+
+	positionRanges.resize(numBones);
+	scaleRanges.resize(numBones);
+
+	for (uint32 i = 0; i < numBones; ++i) {
+		const Curve& positionCurve = rawPositionCurves[i];
+		const float* times = positionTimes.data() + positionCurve.firstKey;
+		const Vector3f* values = positions.data() + positionCurve.firstKey;
+
+		::reduceKeys(times, values, positionCurve.numKeys, settings.positionTolerance,
+				mixVectors, ::vectorError, keys);
+		::calcRange(values, keys, positionRanges[i].min, positionRanges[i].step);
+
+		positionCurves.push_back({static_cast<uint32>(quantizedPositions.size() / 3),
+				static_cast<uint32>(keys.size())});
+
+		for (uint32 key : keys) {
+			addTime(times[key], quantizedPositionTimes, keptPositionTimes);
+			::quantizeVector(values[key], positionRanges[i].min,
+					positionRanges[i].step, quantizedPositions);
+		}
+	}
+
+	for (uint32 i = 0; i < numBones; ++i) {
+		const Curve& rotationCurve = rawRotationCurves[i];
+		const float* times = rotationTimes.data() + rotationCurve.firstKey;
+		const Quaternion* values = rotations.data() + rotationCurve.firstKey;
+
+		::reduceKeys(times, values, rotationCurve.numKeys, settings.rotationTolerance,
+				mixRotations, ::rotationError, keys);
+
+		rotationCurves.push_back({static_cast<uint32>(quantizedRotations.size() / 3),
+				static_cast<uint32>(keys.size())});
+
+		for (uint32 key : keys) {
+			addTime(times[key], quantizedRotationTimes, keptRotationTimes);
+			::quantizeRotation(values[key], quantizedRotations);
+		}
+	}
+
+	for (uint32 i = 0; i < numBones; ++i) {
+		const Curve& scaleCurve = rawScaleCurves[i];
+		const float* times = scaleTimes.data() + scaleCurve.firstKey;
+		const Vector3f* values = scales.data() + scaleCurve.firstKey;
+
+		::reduceKeys(times, values, scaleCurve.numKeys, settings.scaleTolerance,
+				mixVectors, ::vectorError, keys);
+		::calcRange(values, keys, scaleRanges[i].min, scaleRanges[i].step);
+
+		scaleCurves.push_back({static_cast<uint32>(quantizedScales.size() / 3),
+				static_cast<uint32>(keys.size())});
+
+		for (uint32 key : keys) {
+			addTime(times[key], quantizedScaleTimes, keptScaleTimes);
+			::quantizeVector(values[key], scaleRanges[i].min,
+					scaleRanges[i].step, quantizedScales);
+		}
+	}
+
+	ArrayList<float> rawPositionTimes, rawRotationTimes, rawScaleTimes;
+	ArrayList<Vector3f> rawPositions, rawScales;
+	ArrayList<Quaternion> rawRotations;
+
+	rawPositionTimes.swap(positionTimes);
+	positionTimes.swap(keptPositionTimes);
+	rawPositions.swap(positions);
+	rawRotationTimes.swap(rotationTimes);
+	rotationTimes.swap(keptRotationTimes);
+	rawRotations.swap(rotations);
+	rawScaleTimes.swap(scaleTimes);
+	scaleTimes.swap(keptScaleTimes);
+	rawScales.swap(scales);
+
+	compressed = true;
+
+	if (!report) {
+		return;
+	}
+
+	report->rawBytes = rawBytes;
+	report->compressedBytes = getKeyMemoryUsage();
+	report->rawKeys = rawKeys;
+	report->compressedKeys = getNumKeys();
+	report->maxPositionError = 0.f;
+	report->maxRotationError = 0.f;
+	report->maxScaleError = 0.f;
+
+	// measure against every original key through the compressed sampler
+	for (uint32 i = 0; i < numBones; ++i) {
+		uint32 positionCursor = 0, rotationCursor = 0, scaleCursor = 0;
+
+		for (uint32 j = rawPositionCurves[i].firstKey,
+				end = j + rawPositionCurves[i].numKeys; j < end; ++j) {
+			report->maxPositionError = Math::max(report->maxPositionError,
+					::vectorError(rawPositions[j],
+					samplePosition(i, rawPositionTimes[j], positionCursor)));
+		}
+
+		for (uint32 j = rawRotationCurves[i].firstKey,
+				end = j + rawRotationCurves[i].numKeys; j < end; ++j) {
+			report->maxRotationError = Math::max(report->maxRotationError,
+					::rotationError(rawRotations[j],
+					sampleRotation(i, rawRotationTimes[j], rotationCursor)));
+		}
+
+		for (uint32 j = rawScaleCurves[i].firstKey,
+				end = j + rawScaleCurves[i].numKeys; j < end; ++j) {
+			report->maxScaleError = Math::max(report->maxScaleError,
+					::vectorError(rawScales[j],
+					sampleScale(i, rawScaleTimes[j], scaleCursor)));
+		}
+	}
+}
+
+Vector3f Animation::samplePosition(uint32 bone, float time, uint32& cursor) const {
+	const Curve& curve = positionCurves[bone];
+
+	if (curve.numKeys == 0) {
+		return Vector3f(0.f, 0.f, 0.f);
+	}
+
+	if (compressed) {
+		if (!quantizedTimes) {
+			return ::sampleQuantizedVector(&positionTimes[curve.firstKey],
+					&quantizedPositions[3 * curve.firstKey], curve.numKeys,
+					positionRanges[bone].min, positionRanges[bone].step, time, cursor);
+		}
+
+		return ::sampleQuantizedVector(&quantizedPositionTimes[curve.firstKey],
+				&quantizedPositions[3 * curve.firstKey], curve.numKeys,
+				positionRanges[bone].min, positionRanges[bone].step,
+				time * timeScale, cursor);
+	}
+
+	const float* times = &positionTimes[curve.firstKey];
+	const Vector3f* values = &positions[curve.firstKey];
+
+	const uint32 i = ::findKey(times, curve.numKeys, time, cursor);
+
+	if (i + 1 == curve.numKeys || time <= times[i]) {
+		return values[i];
+	}
+
+	return Math::mix(values[i], values[i + 1],
+			(time - times[i]) / (times[i + 1] - times[i]));
+}
+
+Quaternion Animation::sampleRotation(uint32 bone, float time, uint32& cursor) const {
+	const Curve& curve = rotationCurves[bone];
+
+	if (curve.numKeys == 0) {
+		return Quaternion(1.f, 0.f, 0.f, 0.f);
+	}
+
+	if (compressed) {
+		if (!quantizedTimes) {
+			return ::sampleQuantizedRotation(&rotationTimes[curve.firstKey],
+					&quantizedRotations[3 * curve.firstKey], curve.numKeys, time, cursor);
+		}
+
+		return ::sampleQuantizedRotation(&quantizedRotationTimes[curve.firstKey],
+				&quantizedRotations[3 * curve.firstKey], curve.numKeys,
+				time * timeScale, cursor);
+	}
+
+	const float* times = &rotationTimes[curve.firstKey];
+	const Quaternion* values = &rotations[curve.firstKey];
+
+	const uint32 i = ::findKey(times, curve.numKeys, time, cursor);
+
+	if (i + 1 == curve.numKeys || time <= times[i]) {
+		return values[i];
+	}
+
+	return Math::slerp(values[i], values[i + 1],
+			(time - times[i]) / (times[i + 1] - times[i]));
+}
+
+Vector3f Animation::sampleScale(uint32 bone, float time, uint32& cursor) const {
+	const Curve& curve = scaleCurves[bone];
+
+	if (curve.numKeys == 0) {
+		return Vector3f(1.f, 1.f, 1.f);
+	}
+
+	if (compressed) {
+		if (!quantizedTimes) {
+			return ::sampleQuantizedVector(&scaleTimes[curve.firstKey],
+					&quantizedScales[3 * curve.firstKey], curve.numKeys,
+					scaleRanges[bone].min, scaleRanges[bone].step, time, cursor);
+		}
+
+		return ::sampleQuantizedVector(&quantizedScaleTimes[curve.firstKey],
+				&quantizedScales[3 * curve.firstKey], curve.numKeys,
+				scaleRanges[bone].min, scaleRanges[bone].step,
+				time * timeScale, cursor);
+	}
+
+	const float* times = &scaleTimes[curve.firstKey];
+	const Vector3f* values = &scales[curve.firstKey];
+
+	const uint32 i = ::findKey(times, curve.numKeys, time, cursor);
+
+	if (i + 1 == curve.numKeys || time <= times[i]) {
+		return values[i];
+	}
+
+	return Math::mix(values[i], values[i + 1],
+			(time - times[i]) / (times[i + 1] - times[i]));
+}
+
+Animation::CompressedKeys Animation::getCompressedKeys() const {
+	CompressedKeys keys;
+
+	if (!compressed) {
+		return keys;
+	}
+
+	keys.timeScale = timeScale;
+	keys.quantizedTimes = quantizedTimes;
+
+	keys.positionCurves = positionCurves;
+	keys.rotationCurves = rotationCurves;
+	keys.scaleCurves = scaleCurves;
+
+	keys.positionRanges = positionRanges;
+	keys.scaleRanges = scaleRanges;
+
+	keys.quantizedPositionTimes = quantizedPositionTimes;
+	keys.quantizedRotationTimes = quantizedRotationTimes;
+	keys.quantizedScaleTimes = quantizedScaleTimes;
+
+	keys.positionTimes = positionTimes;
+	keys.rotationTimes = rotationTimes;
+	keys.scaleTimes = scaleTimes;
 
-void Animation::addKeyFrame(const KeyFrame& keyFrame) {
-	keyFrames.push_back(keyFrame);
+	keys.positions = quantizedPositions;
+	keys.rotations = quantizedRotations;
+	keys.scales = quantizedScales;
 
-	std::sort(std::begin(keyFrames), std::end(keyFrames), [&](auto a, auto b) {
-		return a.getTime() < b.getTime();
-	});
+	keys.rootMotionBone = rootMotionBone;
+
+	keys.rootPositionTimes = rootPositionTimes;
+	keys.rootPositions = rootPositions;
+	keys.rootRotationTimes = rootRotationTimes;
+	keys.rootRotations = rootRotations;
+
+	return keys;
+}
+
+void Animation::setCompressedKeys(uint32 numBones, CompressedKeys&& keys) {
+	tracks.clear();
+
+	this->numBones = numBones;
+	compressed = true;
+
+	timeScale = keys.timeScale;
+	quantizedTimes = keys.quantizedTimes;
+
+	positionCurves = std::move(keys.positionCurves);
+	rotationCurves = std::move(keys.rotationCurves);
+	scaleCurves = std::move(keys.scaleCurves);
+
+	positionRanges = std::move(keys.positionRanges);
+	scaleRanges = std::move(keys.scaleRanges);
+
+	quantizedPositionTimes = std::move(keys.quantizedPositionTimes);
+	quantizedRotationTimes = std::move(keys.quantizedRotationTimes);
+	quantizedScaleTimes = std::move(keys.quantizedScaleTimes);
+
+	positionTimes = std::move(keys.positionTimes);
+	rotationTimes = std::move(keys.rotationTimes);
+	scaleTimes = std::move(keys.scaleTimes);
+
+	positions.clear();
+	rotations.clear();
+	scales.clear();
+
+	quantizedPositions = std::move(keys.positions);
+	quantizedRotations = std::move(keys.rotations);
+	quantizedScales = std::move(keys.scales);
+
+	rootMotionBone = keys.rootMotionBone;
+
+	rootPositionTimes = std::move(keys.rootPositionTimes);
+	rootPositions = std::move(keys.rootPositions);
+	rootRotationTimes = std::move(keys.rootRotationTimes);
+	rootRotations = std::move(keys.rootRotations);
+}
+
+void Animation::extractRootMotion(uint32 bone) {
+	if (compressed || bone >= numBones) {
+		return;
+	}
+
+	rootMotionBone = bone;
+
+	const Curve& positionCurve = positionCurves[bone];
+	const Curve& rotationCurve = rotationCurves[bone];
+
+	rootPositionTimes.assign(positionTimes.begin() + positionCurve.firstKey,
+			positionTimes.begin() + positionCurve.firstKey + positionCurve.numKeys);
+	rootPositions.assign(positions.begin() + positionCurve.firstKey,
+			positions.begin() + positionCurve.firstKey + positionCurve.numKeys);
+
+	rootRotationTimes.assign(rotationTimes.begin() + rotationCurve.firstKey,
+			rotationTimes.begin() + rotationCurve.firstKey + rotationCurve.numKeys);
+	rootRotations.assign(rotations.begin() + rotationCurve.firstKey,
+			rotations.begin() + rotationCurve.firstKey + rotationCurve.numKeys);
+}
+
+void Animation::getRootMotion(float from, float to, Vector3f& translation,
+		Quaternion& rotation) const {
+	translation = Vector3f(0.f, 0.f, 0.f);
+	rotation = Quaternion(1.f, 0.f, 0.f, 0.f);
+
+	if (!hasRootMotion()) {
+		return;
+	}
+
+	Vector3f startPosition, endPosition;
+	Quaternion startRotation, endRotation;
+
+	sampleRoot(from, startPosition, startRotation);
+
+	if (to < from) {
+		sampleRoot(duration, endPosition, endRotation);
+		::appendRootMotion(translation, rotation, startPosition, startRotation,
+				endPosition, endRotation);
+
+		sampleRoot(0.f, startPosition, startRotation);
+	}
+
+	sampleRoot(to, endPosition, endRotation);
+	::appendRootMotion(translation, rotation, startPosition, startRotation,
+			endPosition, endRotation);
+}
+
+void Animation::getRootMotionReference(Vector3f& position,
+		Quaternion& rotation) const {
+	sampleRoot(0.f, position, rotation);
+}
+
+void Animation::addEvent(const String& eventName, float time) {
+	uint32 nameIndex = std::find(eventNames.begin(), eventNames.end(), eventName)
+			- eventNames.begin();
+
+	if (nameIndex == eventNames.size()) {
+		eventNames.push_back(eventName);
+	}
+
+	auto it = std::upper_bound(events.begin(), events.end(), time,
+			[](float t, const Event& event) { return t < event.time; });
+	events.insert(it, {time, nameIndex});
+}
+
+uintptr Animation::getMemoryUsage() const {
+	uintptr size = getKeyMemoryUsage()
+			+ sizeof(float) * (rootPositionTimes.size() + rootRotationTimes.size())
+			+ sizeof(Vector3f) * rootPositions.size()
+			+ sizeof(Quaternion) * rootRotations.size()
+			+ sizeof(Event) * events.size() + sizeof(String) * eventNames.size();
+
+	for (auto& track : tracks) {
+		size += sizeof(BoneTrack)
+				+ sizeof(float) * (track.positionTimes.size() + track.rotationTimes.size()
+						+ track.scaleTimes.size())
+				+ sizeof(Vector3f) * (track.positions.size() + track.scales.size())
+				+ sizeof(Quaternion) * track.rotations.size();
+	}
+
+	return size;
+}
+
+uint32 Animation::findEvents(float from, float to, uint32& first) const {
+	const auto byTime = [](float t, const Event& event) { return t < event.time; };
+
+	const uint32 begin = std::upper_bound(events.begin(), events.end(), from, byTime)
+			- events.begin();
+	const uint32 end = std::upper_bound(events.begin(), events.end(), to, byTime)
+			- events.begin();
+
+	first = begin;
+
+	if (to < from) {
+		return (events.size() - begin) + end;
+	}
+
+	return end - begin;
+}
+
+void Animation::sampleRoot(float time, Vector3f& position,
+		Quaternion& rotation) const {
+	position = Vector3f(0.f, 0.f, 0.f);
+	rotation = Quaternion(1.f, 0.f, 0.f, 0.f);
+
+	// no cursor is kept, the search falls back to a binary search
+	uint32 cursor = 0;
+
+	if (!rootPositionTimes.empty()) {
+		const uint32 i = ::findKey(rootPositionTimes.data(), rootPositionTimes.size(),
+				time, cursor);
+
+		position = i + 1 == rootPositionTimes.size() || time <= rootPositionTimes[i]
+				? rootPositions[i] : Math::mix(rootPositions[i], rootPositions[i + 1],
+				(time - rootPositionTimes[i])
+				/ (rootPositionTimes[i + 1] - rootPositionTimes[i]));
+	}
+
+	cursor = 0;
+
+	if (!rootRotationTimes.empty()) {
+		const uint32 i = ::findKey(rootRotationTimes.data(), rootRotationTimes.size(),
+				time, cursor);
+
+		rotation = i + 1 == rootRotationTimes.size() || time <= rootRotationTimes[i]
+				? rootRotations[i] : Math::slerp(rootRotations[i], rootRotations[i + 1],
+				(time - rootRotationTimes[i])
+				/ (rootRotationTimes[i + 1] - rootRotationTimes[i]));
+	}
+}
+
+size_t Animation::getKeyMemoryUsage() const {
+	return sizeof(Curve) * (positionCurves.size() + rotationCurves.size()
+					+ scaleCurves.size())
+			+ sizeof(float) * (positionTimes.size() + rotationTimes.size()
+					+ scaleTimes.size())
+			+ sizeof(Vector3f) * (positions.size() + scales.size())
+			+ sizeof(Quaternion) * rotations.size()
+			+ sizeof(QuantizationRange) * (positionRanges.size() + scaleRanges.size())
+			+ sizeof(uint16) * (quantizedPositionTimes.size() + quantizedPositions.size()
+					+ quantizedRotationTimes.size() + quantizedRotations.size()
+					+ quantizedScaleTimes.size() + quantizedScales.size())
+			+ sizeof(float) * (rootPositionTimes.size() + rootRotationTimes.size())
+			+ sizeof(Vector3f) * rootPositions.size()
+			+ sizeof(Quaternion) * rootRotations.size();
 }
+
+namespace {
+	template <typename T>
+	void appendCurve(ArrayList<Animation::Curve>& curves, ArrayList<float>& times,
+			ArrayList<T>& values, const ArrayList<float>& trackTimes,
+			const ArrayList<T>& trackValues) {
+		curves.push_back({static_cast<uint32>(times.size()),
+				static_cast<uint32>(trackTimes.size())});
+
+		times.insert(std::end(times), std::begin(trackTimes), std::end(trackTimes));
+		values.insert(std::end(values), std::begin(trackValues), std::end(trackValues));
+	}
+
+	// returns the last key at or before time, or 0 if time precedes every key
+	template <typename TimeType>
+	uint32 findKey(const TimeType* times, uint32 numKeys, float time, uint32& cursor) {
+		uint32 i = cursor < numKeys ? cursor : 0;
+
+		if (times[i] <= time) {
+			// forward playback stays on this key or moves to the next one
+			if (i + 1 == numKeys || time < times[i + 1]) {
+				cursor = i;
+				return i;
+			}
+
+			if (i + 2 == numKeys || time < times[i + 2]) {
+				cursor = i + 1;
+				return i + 1;
+			}
+		}
+
+		const TimeType* key = std::upper_bound(times, times + numKeys, time);
+		i = key == times ? 0 : static_cast<uint32>(key - times) - 1;
+
+		cursor = i;
+		return i;
+	}
+
+	float vectorError(const Vector3f& a, const Vector3f& b) {
+		return Math::length(a - b);
+	}
+
+	// angle between the two rotations
+	float rotationError(const Quaternion& a, const Quaternion& b) {
+		return 2.f * Math::acos(Math::min(Math::abs(Math::dot(a, b)), 1.f));
+	}
+
+	// keeps the first and last key and every key needed to bring each
+	// dropped key within tolerance of the interpolation across it
+	template <typename T, typename Interpolate, typename Error>
+	void reduceKeys(const float* times, const T* values, uint32 numKeys, float tolerance,
+			Interpolate interpolate, Error error, ArrayList<uint32>& keys) {
+		keys.clear();
+
+		if (numKeys == 0) {
+			return;
+		}
+
+		bool constant = true;
+
+		for (uint32 i = 1; i < numKeys && constant; ++i) {
+			constant = error(values[0], values[i]) <= tolerance;
+		}
+
+		keys.push_back(0);
+
+		if (constant) {
+			return;
+		}
+
+		const auto segmentFits = [&](uint32 a, uint32 b) {
+			const float span = times[b] - times[a];
+
+			for (uint32 k = a + 1; k < b; ++k) {
+				const float amt = span > 0.f ? (times[k] - times[a]) / span : 0.f;
+
+				if (error(interpolate(values[a], values[b], amt), values[k]) > tolerance) {
+					return false;
+				}
+			}
+
+			return true;
+		};
+
+		for (uint32 a = 0; a + 1 < numKeys;) {
+			uint32 b = a + 1;
+
+			while (b + 1 < numKeys && segmentFits(a, b + 1)) {
+				++b;
+			}
+
+			keys.push_back(b);
+			a = b;
+		}
+	}
+
+	void calcRange(const Vector3f* values, const ArrayList<uint32>& keys,
+			Vector3f& min, Vector3f& step) {
+		if (keys.empty()) {
+			min = Vector3f(0.f, 0.f, 0.f);
+			step = Vector3f(0.f, 0.f, 0.f);
+
+			return;
+		}
+
+		min = values[keys[0]];
+		Vector3f max = min;
+
+		for (uint32 key : keys) {
+			min = Math::min(min, values[key]);
+			max = Math::max(max, values[key]);
+		}
+
+		step = (max - min) / QUANTIZED_MAX;
+	}
+
+	void quantizeVector(const Vector3f& v, const Vector3f& min, const Vector3f& step,
+			ArrayList<uint16>& output) {
+		for (uint32 i = 0; i < 3; ++i) {
+			const float q = step[i] > 0.f ? (v[i] - min[i]) / step[i] + 0.5f : 0.f;
+			output.push_back(static_cast<uint16>(Math::clamp(q, 0.f, QUANTIZED_MAX)));
+		}
+	}
+
+	Vector3f dequantizeVector(const uint16* q, const Vector3f& min, const Vector3f& step) {
+		return min + Vector3f(q[0], q[1], q[2]) * step;
+	}
+
+	// smallest three: the largest component is dropped and rebuilt from the
+	// unit length, its index goes in the top bits of the first two values and
+	// the other three are stored as 15 bits in [-1/sqrt(2), 1/sqrt(2)]
+	void quantizeRotation(const Quaternion& rotation, ArrayList<uint16>& output) {
+		uint32 largest = 0;
+
+		for (uint32 i = 1; i < 4; ++i) {
+			if (Math::abs(rotation[i]) > Math::abs(rotation[largest])) {
+				largest = i;
+			}
+		}
+
+		// q and -q are the same rotation, keep the dropped component positive
+		const float sign = rotation[largest] < 0.f ? -1.f : 1.f;
+
+		uint16 q[3];
+
+		for (uint32 i = 0, j = 0; i < 4; ++i) {
+			if (i != largest) {
+				const float v = (sign * rotation[i] * SQRT_2 + 1.f) * 0.5f;
+				q[j++] = static_cast<uint16>(Math::clamp(v * QUANTIZED_COMPONENT_MAX + 0.5f,
+						0.f, QUANTIZED_COMPONENT_MAX));
+			}
+		}
+
+		output.push_back(static_cast<uint16>(((largest >> 1) << 15) | q[0]));
+		output.push_back(static_cast<uint16>(((largest & 1) << 15) | q[1]));
+		output.push_back(q[2]);
+	}
+
+	Quaternion dequantizeRotation(const uint16* q) {
+		const uint32 largest = ((q[0] >> 15) << 1) | (q[1] >> 15);
+		const uint16 values[3] = {static_cast<uint16>(q[0] & 0x7FFF),
+				static_cast<uint16>(q[1] & 0x7FFF), q[2]};
+
+		Quaternion rotation;
+		float sumSquares = 0.f;
+
+		for (uint32 i = 0, j = 0; i < 4; ++i) {
+			if (i != largest) {
+				const float v = (values[j++] / QUANTIZED_COMPONENT_MAX * 2.f - 1.f) * R_SQRT_2;
+
+				rotation[i] = v;
+				sumSquares += v * v;
+			}
+		}
+
+		rotation[largest] = Math::sqrt(Math::max(1.f - sumSquares, 0.f));
+
+		return rotation;
+	}
+
+	template <typename TimeType>
+	Vector3f sampleQuantizedVector(const TimeType* times, const uint16* values,
+			uint32 numKeys, const Vector3f& min, const Vector3f& step,
+			float time, uint32& cursor) {
+		const uint32 i = ::findKey(times, numKeys, time, cursor);
+		const Vector3f a = ::dequantizeVector(values + 3 * i, min, step);
+
+		if (i + 1 == numKeys || time <= times[i]) {
+			return a;
+		}
+
+		const Vector3f b = ::dequantizeVector(values + 3 * (i + 1), min, step);
+
+		// keys closer than one time step share a quantized time
+		if (times[i + 1] == times[i]) {
+			return b;
+		}
+
+		return Math::mix(a, b, (time - times[i]) / (times[i + 1] - times[i]));
+	}
+
+	template <typename TimeType>
+	Quaternion sampleQuantizedRotation(const TimeType* times, const uint16* values,
+			uint32 numKeys, float time, uint32& cursor) {
+		const uint32 i = ::findKey(times, numKeys, time, cursor);
+		const Quaternion a = ::dequantizeRotation(values + 3 * i);
+
+		if (i + 1 == numKeys || time <= times[i]) {
+			return a;
+		}
+
+		const Quaternion b = ::dequantizeRotation(values + 3 * (i + 1));
+
+		if (times[i + 1] == times[i]) {
+			return b;
+		}
+
+		return Math::slerp(a, b, (time - times[i]) / (times[i + 1] - times[i]));
+	}
+
+	// appends the movement from start to end, expressed relative to start, to
+	// the movement accumulated so far
+	void appendRootMotion(Vector3f& translation, Quaternion& rotation,
+			const Vector3f& startPosition, const Quaternion& startRotation,
+			const Vector3f& endPosition, const Quaternion& endRotation) {
+		const Quaternion inverseStart = Math::conjugate(startRotation);
+
+		translation += Math::rotateBy(rotation,
+				Math::rotateBy(inverseStart, endPosition - startPosition));
+		rotation = Math::normalize(rotation * (inverseStart * endRotation));
+	}
+};
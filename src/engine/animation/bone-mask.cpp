@@ -0,0 +1,28 @@
+#include "engine/animation/bone-mask.hpp"
+
+#include <engine/animation/rig.hpp>
+
+BoneMask::BoneMask(const Rig& rig, float weight)
+		: weights(rig.getNumBones(), weight) {}
+
+void BoneMask::setBranchWeight(const Rig& rig, const String& boneName, float weight) {
+	const int32 root = rig.findBone(boneName);
+
+	if (root < 0) {
+		return;
+	}
+
+	const int32* parents = rig.getParentIndices();
+
+	ArrayList<bool> inBranch(rig.getNumBones(), false);
+	inBranch[root] = true;
+	weights[root] = weight;
+
+	// parents precede their children, so one pass reaches the whole branch
+	for (uint32 i = root + 1; i < rig.getNumBones(); ++i) {
+		if (parents[i] >= 0 && inBranch[parents[i]]) {
+			inBranch[i] = true;
+			weights[i] = weight;
+		}
+	}
+}
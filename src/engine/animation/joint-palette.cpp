@@ -0,0 +1,58 @@
+#include "engine/animation/joint-palette.hpp"
+
+#include <engine/core/memory.hpp>
+
+#include <engine/math/quaternion.hpp>
+
+namespace {
+	void packMatrix3x4(const Matrix4f& joint, Vector4f* dest);
+	void packDualQuaternion(const Matrix4f& joint, Vector4f* dest);
+};
+
+void JointPalette::pack(JointPaletteFormat format, const Matrix4f* joints,
+		uint32 numJoints, Vector4f* dest) {
+	switch (format) {
+		case JointPaletteFormat::MATRIX4X4:
+			Memory::memcpy(dest, joints, numJoints * sizeof(Matrix4f));
+			break;
+		case JointPaletteFormat::MATRIX3X4:
+			for (uint32 i = 0; i < numJoints; ++i) {
+				::packMatrix3x4(joints[i], dest + 3 * i);
+			}
+			break;
+		case JointPaletteFormat::DUAL_QUATERNION:
+			for (uint32 i = 0; i < numJoints; ++i) {
+				::packDualQuaternion(joints[i], dest + 2 * i);
+			}
+			break;
+	}
+}
+
+namespace {
+	// rows of the upper 3x4 part, so the shader computes dot(row, vec4(p, 1))
+	void packMatrix3x4(const Matrix4f& joint, Vector4f* dest) {
+		for (uint32 r = 0; r < 3; ++r) {
+			dest[r] = Vector4f(joint[0][r], joint[1][r], joint[2][r], joint[3][r]);
+		}
+	}
+
+	// stored as (x, y, z, w) of the real part followed by the dual part
+	void packDualQuaternion(const Matrix4f& joint, Vector4f* dest) {
+		const Matrix3f rotation(Math::normalize(Vector3f(joint[0])),
+				Math::normalize(Vector3f(joint[1])),
+				Math::normalize(Vector3f(joint[2])));
+
+		Quaternion real = Math::normalize(Math::mat3ToQuat(rotation));
+
+		// a consistent hemisphere keeps neighbouring joints blendable
+		if (real.w < 0.f) {
+			real = -real;
+		}
+
+		const Quaternion dual = 0.5f * (Quaternion(0.f, joint[3][0], joint[3][1],
+				joint[3][2]) * real);
+
+		dest[0] = Vector4f(real.x, real.y, real.z, real.w);
+		dest[1] = Vector4f(dual.x, dual.y, dual.z, dual.w);
+	}
+};
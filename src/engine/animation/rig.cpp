@@ -6,13 +6,58 @@ void Rig::resetBones() {
 	}
 }
 
-void Rig::calcRootBone() {
-	for (uint32 i = 0; i < bones.size(); ++i) {
-		if (bones[i].parent < 0) {
-			DEBUG_LOG_TEMP("Root joint is joint %d", i);
-			rootBone = i;
+void Rig::sortBones(ArrayList<uint32>& remap) {
+	const uint32 numBones = bones.size();
+
+	ArrayList<uint32> order;
+	ArrayList<uint32> chain;
+
+	order.reserve(numBones);
+	remap.assign(numBones, (uint32)-1);
+
+	// place each bone after its not yet placed ancestors, root-most first
+	for (uint32 i = 0; i < numBones; ++i) {
+		for (int32 j = i; j >= 0 && remap[j] == (uint32)-1; j = bones[j].parent) {
+			chain.push_back(j);
+		}
 
-			return;
+		while (!chain.empty()) {
+			remap[chain.back()] = order.size();
+			order.push_back(chain.back());
+			chain.pop_back();
 		}
 	}
+
+	ArrayList<Bone> sortedBones;
+	sortedBones.reserve(numBones);
+
+	ArrayList<bool> sortedLeafBones(numBones);
+
+	for (uint32 i = 0; i < numBones; ++i) {
+		sortedBones.push_back(bones[order[i]]);
+
+		Bone& bone = sortedBones.back();
+		bone.index = i;
+		bone.parent = bone.parent < 0 ? -1 : remap[bone.parent];
+
+		parentIndices[i] = bone.parent;
+		sortedLeafBones[i] = leafBones[order[i]];
+		nameMap[bone.name] = i;
+	}
+
+	bones.swap(sortedBones);
+	leafBones.swap(sortedLeafBones);
+}
+
+uintptr Rig::getMemoryUsage() const {
+	uintptr size = bones.size() * (sizeof(Bone) + sizeof(int32) + sizeof(Matrix4f))
+			+ leafBones.size() / 8
+			+ nameMap.size() * (sizeof(String) + sizeof(uint32));
+
+	// names are stored in the bone and again as the name map's key
+	for (auto& bone : bones) {
+		size += 2 * bone.name.size();
+	}
+
+	return size;
 }
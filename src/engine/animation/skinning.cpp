@@ -0,0 +1,164 @@
+#include "engine/animation/skinning.hpp"
+
+#include <engine/animation/rig.hpp>
+
+#include <engine/core/memory.hpp>
+#include <engine/core/job-system.hpp>
+
+#include <engine/rendering/indexed-model.hpp>
+
+#include <engine/math/math.hpp>
+
+#include <immintrin.h>
+
+#define POSITION_ELEMENT 0
+#define NORMAL_ELEMENT 2
+#define JOINT_ELEMENT 5
+#define WEIGHT_ELEMENT 6
+
+namespace {
+	struct InfluenceLayout {
+		const float* joints;
+		const float* weights;
+
+		uint32 jointFormat;
+		uint32 weightFormat;
+
+		uint32 jointSize;
+		uint32 weightSize;
+	};
+
+	InfluenceLayout getInfluenceLayout(const IndexedModel& model);
+
+	void loadInfluences(const InfluenceLayout& layout, uint32 vertex,
+			uint32* joints, float* weights);
+};
+
+void Skinning::skinVertices(const IndexedModel& model, const Matrix4f* palette,
+		uint32 firstVertex, uint32 numVertices, Vector3f* positions,
+		Vector3f* normals) {
+	const InfluenceLayout layout = ::getInfluenceLayout(model);
+
+	const Vector3f* srcPositions = reinterpret_cast<const Vector3f*>(
+			model.getElementData(POSITION_ELEMENT));
+	const Vector3f* srcNormals = reinterpret_cast<const Vector3f*>(
+			model.getElementData(NORMAL_ELEMENT));
+
+	uint32 joints[Rig::MAX_WEIGHTS];
+	float weights[Rig::MAX_WEIGHTS];
+
+	float result[4];
+
+	for (uint32 v = firstVertex, end = firstVertex + numVertices; v < end; ++v) {
+		::loadInfluences(layout, v, joints, weights);
+
+		// blend the columns of the influencing joints like the shader does
+		__m128 c0 = _mm_setzero_ps();
+		__m128 c1 = _mm_setzero_ps();
+		__m128 c2 = _mm_setzero_ps();
+		__m128 c3 = _mm_setzero_ps();
+
+		for (uint32 i = 0; i < Rig::MAX_WEIGHTS; ++i) {
+			if (weights[i] == 0.f) {
+				continue;
+			}
+
+			const float* m = &palette[joints[i]][0][0];
+			const __m128 w = _mm_set1_ps(weights[i]);
+
+			c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(m)));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+		}
+
+		const Vector3f& p = srcPositions[v];
+
+		_mm_storeu_ps(result, _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+				_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3)));
+		positions[v] = Vector3f(result[0], result[1], result[2]);
+
+		if (normals) {
+			const Vector3f& n = srcNormals[v];
+
+			_mm_storeu_ps(result, _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(c0, _mm_set1_ps(n.x)), _mm_mul_ps(c1, _mm_set1_ps(n.y))),
+					_mm_mul_ps(c2, _mm_set1_ps(n.z))));
+
+			const Vector3f normal(result[0], result[1], result[2]);
+			const float length = Math::length(normal);
+
+			normals[v] = length > 0.f ? normal / length : normal;
+		}
+	}
+}
+
+void Skinning::skinModel(const IndexedModel& model, const Rig& rig,
+		Vector3f* positions, Vector3f* normals) {
+	skinVertices(model, rig.getTransformSet(), 0, model.getNumVertices(),
+			positions, normals);
+}
+
+void Skinning::skinModel(const IndexedModel& model, const Rig& rig,
+		Vector3f* positions, Vector3f* normals, JobSystem& jobSystem,
+		uint32 grainSize) {
+	const uint32 numVertices = model.getNumVertices();
+	grainSize = Math::max(grainSize, 1u);
+
+	const uint32 numChunks = (numVertices + grainSize - 1) / grainSize;
+
+	jobSystem.parallelFor(0, numChunks, 1, [&](uint32 chunk) {
+		const uint32 first = chunk * grainSize;
+
+		skinVertices(model, rig.getTransformSet(), first,
+				Math::min(grainSize, numVertices - first), positions, normals);
+	});
+}
+
+namespace {
+	InfluenceLayout getInfluenceLayout(const IndexedModel& model) {
+		const uint32* sizes = model.getElementSizes();
+		const uint32* formats = model.getElementFormats();
+
+		return {model.getElementData(JOINT_ELEMENT), model.getElementData(WEIGHT_ELEMENT),
+				formats[JOINT_ELEMENT], formats[WEIGHT_ELEMENT],
+				sizes[JOINT_ELEMENT], sizes[WEIGHT_ELEMENT]};
+	}
+
+	// unpacks the formats written by the asset loader, float elements hold
+	// one influence per component
+	void loadInfluences(const InfluenceLayout& layout, uint32 vertex,
+			uint32* joints, float* weights) {
+		uint32 words[4];
+
+		const float* jointData = layout.joints + vertex * layout.jointSize;
+		Memory::memcpy(words, jointData, layout.jointSize * sizeof(float));
+
+		for (uint32 i = 0; i < Rig::MAX_WEIGHTS; ++i) {
+			switch (layout.jointFormat) {
+				case IndexedModel::FORMAT_UBYTE4:
+					joints[i] = (words[0] >> (8 * i)) & 0xFF;
+					break;
+				case IndexedModel::FORMAT_USHORT4:
+					joints[i] = (words[i / 2] >> (16 * (i % 2))) & 0xFFFF;
+					break;
+				default:
+					joints[i] = i < layout.jointSize
+							? static_cast<uint32>(jointData[i]) : 0;
+			}
+		}
+
+		const float* weightData = layout.weights + vertex * layout.weightSize;
+		Memory::memcpy(words, weightData, layout.weightSize * sizeof(float));
+
+		for (uint32 i = 0; i < Rig::MAX_WEIGHTS; ++i) {
+			if (layout.weightFormat == IndexedModel::FORMAT_UBYTE4_NORM) {
+				weights[i] = static_cast<float>((words[0] >> (8 * i)) & 0xFF) / 255.f;
+			}
+			else {
+				weights[i] = i < layout.weightSize ? weightData[i] : 0.f;
+			}
+		}
+	}
+};
@@ -2,58 +2,592 @@
 
 #include <engine/animation/animation.hpp>
 #include <engine/animation/rig.hpp>
+#include <engine/animation/bone-mask.hpp>
 
 #include <engine/components/rigged-mesh.hpp>
+#include <engine/components/transform-component.hpp>
+
+#include <engine/core/job-system.hpp>
 
 #include <engine/ecs/registry.hpp>
 
+#include <engine/rendering/vertex-array.hpp>
+
+#include <engine/math/math.hpp>
+#include <engine/math/transform.hpp>
+
 namespace {
-	void calcJointTransform(Rig& rig, KeyFrame& frame0, KeyFrame& frame1,
-			float lerpAmt, Bone* bone, const Matrix4f& parentTransform);
-};
+	void addLODStats(AnimationLODStats& total, const AnimationLODStats& stats);
 
-void updateAnimators(Registry& registry, float deltaTime) {
-	registry.view<Animator, RiggedMesh>().each([&](auto& animator, auto& mesh) {
-		if (animator.currentAnim) {
-			auto& rig = *mesh.rig;
+	bool hasClips(const Animator& animator);
+	void removeClip(AnimationLayer& layer, uint32 clipIndex);
+	void advanceClips(AnimationLayer& layer, float deltaTime);
+
+	void calcRootMotion(Animator& animator, const Rig& rig);
+
+	void updateAnimator(Animator& animator, Rig& rig, float deltaTime,
+			AnimationLODStats& stats);
 
-			animator.animTime += deltaTime;
-			KeyFrame& currentFrame = animator.currentAnim->getKeyFrame(animator.frameIndex);
-			KeyFrame& nextFrame = animator.currentAnim->getKeyFrame(animator.frameIndex + 1);
+	// model space transform of every bone, grown per thread and never shrunk
+	thread_local ArrayList<Matrix4f> modelTransforms;
 
-			float lerpAmt = (animator.animTime - currentFrame.getTime())
-					/ (nextFrame.getTime() - currentFrame.getTime());
+	void calcJointTransforms(Rig& rig, Animator& animator, Matrix4f* localCache,
+			bool skipLeafBones, AnimationLODStats& stats);
+};
+
+void playAnimation(Animator& animator, Animation* anim, uint32 layerIndex,
+		float fadeTime) {
+	AnimationLayer& layer = animator.layers[layerIndex];
+	animator.numLayers = Math::max(animator.numLayers, layerIndex + 1);
 
-			::calcJointTransform(rig, currentFrame, nextFrame,
-					lerpAmt, rig.getRootBone(), Matrix4f(1.f));
+	int32 target = -1;
 
-			if (animator.animTime >= nextFrame.getTime()) {
-				++animator.frameIndex;
+	for (uint32 i = 0; i < layer.numClips; ++i) {
+		if (layer.clips[i].animation == anim) {
+			target = i;
+		}
+	}
 
-				if (animator.frameIndex == animator.currentAnim->getNumFrames() - 1) {
-					animator.frameIndex = 0;
-					animator.animTime -= nextFrame.getTime();
+	if (target < 0) {
+		if (layer.numClips < AnimationLayer::MAX_CLIPS) {
+			target = layer.numClips++;
+		}
+		else {
+			// a full layer gives up the clip contributing the least
+			target = 0;
+
+			for (uint32 i = 1; i < layer.numClips; ++i) {
+				if (layer.clips[i].weight < layer.clips[target].weight) {
+					target = i;
 				}
 			}
 		}
+
+		AnimationClipState& clip = layer.clips[target];
+		clip.animation = anim;
+		clip.time = 0.f;
+		clip.speed = 1.f;
+		clip.weight = 0.f;
+
+		std::fill(std::begin(clip.keyCursors), std::end(clip.keyCursors), 0);
+	}
+
+	for (uint32 i = 0; i < layer.numClips; ++i) {
+		AnimationClipState& clip = layer.clips[i];
+
+		clip.targetWeight = static_cast<int32>(i) == target ? 1.f : 0.f;
+		clip.fadeRate = fadeTime > 0.f ? 1.f / fadeTime : 0.f;
+
+		if (fadeTime <= 0.f) {
+			clip.weight = clip.targetWeight;
+		}
+	}
+
+	if (fadeTime <= 0.f) {
+		for (uint32 i = layer.numClips; i-- > 0;) {
+			if (static_cast<int32>(i) != target) {
+				::removeClip(layer, i);
+			}
+		}
+	}
+}
+
+AnimationClipState* addAnimation(Animator& animator, Animation* anim, uint32 layerIndex,
+		float weight) {
+	AnimationLayer& layer = animator.layers[layerIndex];
+
+	if (layer.numClips == AnimationLayer::MAX_CLIPS) {
+		return nullptr;
+	}
+
+	animator.numLayers = Math::max(animator.numLayers, layerIndex + 1);
+
+	AnimationClipState& clip = layer.clips[layer.numClips++];
+	clip.animation = anim;
+	clip.time = 0.f;
+	clip.speed = 1.f;
+	clip.weight = weight;
+	clip.targetWeight = weight;
+	clip.fadeRate = 0.f;
+
+	std::fill(std::begin(clip.keyCursors), std::end(clip.keyCursors), 0);
+
+	return &clip;
+}
+
+void updateAnimationLODs(Registry& registry, const Vector3f& cameraPosition,
+		const AnimationLODSettings& settings) {
+	registry.view<TransformComponent, Animator, RiggedMesh>().each([&](auto entity,
+			auto& tfc, auto& animator, auto& mesh) {
+		const Transform& transform = tfc.transform;
+		const Vector3f scale = transform.getScale();
+
+		// the mesh's bounding sphere in world space
+		Vector3f center = transform.getPosition();
+		float radius = 1.f;
+
+		if (mesh.vertexArray->hasBounds()) {
+			const Sphere& sphere = mesh.vertexArray->getBoundingSphere();
+
+			center = transform.transform(sphere.getCenter(), 1.f);
+			radius = sphere.getRadius();
+		}
+
+		radius *= Math::max(Math::max(scale.x, scale.y), scale.z);
+
+		const float distance = Math::length(center - cameraPosition);
+		const float screenSize = distance > 0.f ? radius / distance : radius;
+
+		uint32 lod = 0;
+
+		while (lod < Animator::NUM_LODS - 1 && screenSize < settings.minScreenSizes[lod]) {
+			++lod;
+		}
+
+		if (lod != animator.lod) {
+			// spread the evaluations of animators at the same LOD over frames
+			animator.lod = lod;
+			animator.lodFrame = static_cast<uint32>(entity) % (1u << lod);
+		}
+
+		animator.skipLeafBones = lod >= settings.leafSkipLOD;
 	});
 }
 
+void updateAnimators(Registry& registry, float deltaTime,
+		AnimationLODStats* stats) {
+	AnimationLODStats updateStats;
+
+	registry.view<Animator, RiggedMesh>().each([&](auto& animator, auto& mesh) {
+		::updateAnimator(animator, *mesh.rig, deltaTime, updateStats);
+	});
+
+	if (stats) {
+		*stats = updateStats;
+	}
+}
+
+void updateAnimators(Registry& registry, float deltaTime, JobSystem& jobSystem,
+		AnimatorTaskList& taskList, uint32 grainSize) {
+	// the view is gathered first so that it can be split by index, every task
+	// only writes its own animator and rig so the result matches the serial path
+	auto& tasks = taskList.tasks;
+	auto& chunkStats = taskList.chunkStats;
+
+	tasks.clear();
+
+	registry.view<Animator, RiggedMesh>().each([&](auto& animator, auto& mesh) {
+		if (::hasClips(animator)) {
+			tasks.push_back({&animator, mesh.rig});
+		}
+	});
+
+	if (grainSize == 0) {
+		grainSize = 1;
+	}
+
+	// one job per chunk, each counting into its own stats
+	const uint32 numTasks = static_cast<uint32>(tasks.size());
+	const uint32 numChunks = (numTasks + grainSize - 1) / grainSize;
+
+	chunkStats.clear();
+	chunkStats.resize(numChunks);
+
+	jobSystem.parallelFor(0, numChunks, 1, [&](uint32 chunk) {
+		AnimationLODStats& stats = chunkStats[chunk];
+		const uint32 end = Math::min(numTasks, (chunk + 1) * grainSize);
+
+		for (uint32 i = chunk * grainSize; i < end; ++i) {
+			::updateAnimator(*tasks[i].animator, *tasks[i].rig, deltaTime, stats);
+		}
+	});
+
+	taskList.stats = AnimationLODStats();
+
+	for (const AnimationLODStats& stats : chunkStats) {
+		::addLODStats(taskList.stats, stats);
+	}
+
+	tasks.endFrame();
+	chunkStats.endFrame();
+}
+
 namespace {
-	void calcJointTransform(Rig& rig, KeyFrame& frame0, KeyFrame& frame1,
-			float lerpAmt, Bone* bone, const Matrix4f& parentTransform) {
-		Transform res;
+	void addLODStats(AnimationLODStats& total, const AnimationLODStats& stats) {
+		for (uint32 i = 0; i < Animator::NUM_LODS; ++i) {
+			total.numAnimators[i] += stats.numAnimators[i];
+			total.numEvaluated[i] += stats.numEvaluated[i];
+			total.numInterpolated[i] += stats.numInterpolated[i];
+		}
+
+		total.numSkippedBones += stats.numSkippedBones;
+	}
+
+	bool hasClips(const Animator& animator) {
+		for (uint32 i = 0; i < animator.numLayers; ++i) {
+			if (animator.layers[i].numClips > 0) {
+				return true;
+			}
+		}
 
-		frame0.getBoneTransform(bone->name).mix(frame1.getBoneTransform(bone->name), lerpAmt, res);
-		
-		Matrix4f globalTransform = parentTransform * res.toMatrix();
+		return false;
+	}
+
+	// swaps the clip with the last one so both keep their cursor storage
+	void removeClip(AnimationLayer& layer, uint32 clipIndex) {
+		--layer.numClips;
+
+		if (clipIndex != layer.numClips) {
+			std::swap(layer.clips[clipIndex], layer.clips[layer.numClips]);
+		}
+
+		layer.clips[layer.numClips].animation = nullptr;
+	}
+
+	void advanceClips(AnimationLayer& layer, float deltaTime) {
+		for (uint32 i = layer.numClips; i-- > 0;) {
+			AnimationClipState& clip = layer.clips[i];
+
+			if (clip.weight != clip.targetWeight) {
+				const float step = clip.fadeRate * deltaTime;
+
+				if (clip.fadeRate <= 0.f || Math::abs(clip.targetWeight - clip.weight) <= step) {
+					clip.weight = clip.targetWeight;
+				}
+				else {
+					clip.weight += clip.targetWeight > clip.weight ? step : -step;
+				}
+			}
+
+			if (clip.weight <= 0.f && clip.targetWeight <= 0.f) {
+				::removeClip(layer, i);
+				continue;
+			}
+
+			const float duration = clip.animation->getDuration();
+			clip.time += deltaTime * clip.speed;
 
-		rig.setFinalTransform(bone->index,
-				rig.getGlobalInverseTransform() * globalTransform * bone->localTransform);
+			if (duration > 0.f && (clip.time >= duration || clip.time < 0.f)) {
+				clip.time = Math::fmod(clip.time, duration);
 
-		for (uint32 i = 0; i < bone->children.size(); ++i) {
-			::calcJointTransform(rig, frame0, frame1, lerpAmt,
-					&rig.getBone(bone->children[i]), globalTransform);
+				if (clip.time < 0.f) {
+					clip.time += duration;
+				}
+			}
 		}
 	}
+
+	// Blends the root motion of the base layer's clips by their weights. Each
+	// clip's motion is relative to its root at the first key, which is where
+	// the pose holds the root, so that frame maps it to the mesh's space.
+	void calcRootMotion(Animator& animator, const Rig& rig) {
+		const AnimationLayer& layer = animator.layers[0];
+		const Matrix4f& globalInverse = rig.getGlobalInverseTransform();
+		const Quaternion meshRotation = Math::normalize(Math::mat4ToQuat(globalInverse));
+
+		Vector3f translation(0.f, 0.f, 0.f);
+		Quaternion rotation(0.f, 0.f, 0.f, 0.f);
+		float weightSum = 0.f;
+
+		for (uint32 i = 0; i < layer.numClips; ++i) {
+			const AnimationClipState& clip = layer.clips[i];
+			const Animation& anim = *clip.animation;
+
+			if (!anim.hasRootMotion() || clip.weight <= 0.f
+					|| anim.getNumBones() != rig.getNumBones()) {
+				continue;
+			}
+
+			Vector3f t;
+			Quaternion r;
+
+			if (clip.speed >= 0.f) {
+				anim.getRootMotion(clip.previousTime, clip.time, t, r);
+			}
+			else {
+				anim.getRootMotion(clip.time, clip.previousTime, t, r);
+
+				r = Math::conjugate(r);
+				t = -Math::rotateBy(r, t);
+			}
+
+			Vector3f referencePosition;
+			Quaternion referenceRotation;
+			anim.getRootMotionReference(referencePosition, referenceRotation);
+
+			const Quaternion basis = meshRotation * referenceRotation;
+
+			t = Vector3f(globalInverse * Vector4f(Math::rotateBy(referenceRotation, t), 0.f));
+			r = basis * r * Math::conjugate(basis);
+
+			if (Math::dot(rotation, r) < 0.f) {
+				r = -r;
+			}
+
+			translation += t * clip.weight;
+			rotation += r * clip.weight;
+			weightSum += clip.weight;
+		}
+
+		if (weightSum > 0.f) {
+			animator.rootMotionTranslation = translation / weightSum;
+			animator.rootMotionRotation = Math::normalize(rotation);
+		}
+	}
+
+	void updateAnimator(Animator& animator, Rig& rig, float deltaTime,
+			AnimationLODStats& stats) {
+		if (!::hasClips(animator)) {
+			return;
+		}
+
+		const uint32 lod = Math::min(animator.lod, Animator::NUM_LODS - 1);
+		const uint32 period = 1u << lod;
+		const uint32 numBones = rig.getNumBones();
+
+		Matrix4f* palette = rig.getTransformSet();
+		const bool palettesValid = animator.lodPalettes.size() == 2 * numBones;
+
+		// reset every frame, so frames that only interpolate report no events
+		// and no root motion
+		for (uint32 i = 0; i < animator.numLayers; ++i) {
+			for (uint32 j = 0; j < animator.layers[i].numClips; ++j) {
+				animator.layers[i].clips[j].previousTime = animator.layers[i].clips[j].time;
+			}
+		}
+
+		animator.rootMotionTranslation = Vector3f(0.f, 0.f, 0.f);
+		animator.rootMotionRotation = Quaternion(1.f, 0.f, 0.f, 0.f);
+
+		animator.lodDeltaTime += deltaTime;
+		++stats.numAnimators[lod];
+
+		// between evaluations the palette moves from the second last evaluation
+		// to the last one, one period behind the clips
+		if (lod > 0 && palettesValid && animator.lodFrame + 1 < period) {
+			const Matrix4f* previous = animator.lodPalettes.data();
+			const Matrix4f* next = previous + numBones;
+			const float amt = static_cast<float>(++animator.lodFrame) / period;
+
+			for (uint32 i = 0; i < numBones; ++i) {
+				palette[i] = previous[i] * (1.f - amt) + next[i] * amt;
+			}
+
+			++stats.numInterpolated[lod];
+
+			return;
+		}
+
+		for (uint32 i = 0; i < animator.numLayers; ++i) {
+			::advanceClips(animator.layers[i], animator.lodDeltaTime);
+		}
+
+		animator.lodFrame = 0;
+		animator.lodDeltaTime = 0.f;
+
+		if (animator.applyRootMotion) {
+			::calcRootMotion(animator, rig);
+		}
+
+		if (!::hasClips(animator)) {
+			return;
+		}
+
+		// leaf bones are only frozen once a full evaluation has cached them
+		Matrix4f* localCache = nullptr;
+		bool skipLeafBones = false;
+
+		if (animator.skipLeafBones || !animator.localTransforms.empty()) {
+			if (animator.localTransforms.size() == numBones) {
+				skipLeafBones = animator.skipLeafBones;
+			}
+			else {
+				animator.localTransforms.resize(numBones);
+			}
+
+			localCache = animator.localTransforms.data();
+		}
+
+		::calcJointTransforms(rig, animator, localCache, skipLeafBones, stats);
+
+		++stats.numEvaluated[lod];
+
+		if (lod == 0) {
+			animator.lodPalettes.clear();
+			return;
+		}
+
+		if (!palettesValid) {
+			animator.lodPalettes.resize(2 * numBones);
+			std::copy(palette, palette + numBones, animator.lodPalettes.data());
+		}
+		else {
+			std::copy(animator.lodPalettes.data() + numBones,
+					animator.lodPalettes.data() + 2 * numBones,
+					animator.lodPalettes.data());
+		}
+
+		std::copy(palette, palette + numBones, animator.lodPalettes.data() + numBones);
+		std::copy(animator.lodPalettes.data(), animator.lodPalettes.data() + numBones,
+				palette);
+	}
+
+	void calcJointTransforms(Rig& rig, Animator& animator, Matrix4f* localCache,
+			bool skipLeafBones, AnimationLODStats& stats) {
+		const uint32 numBones = rig.getNumBones();
+		const int32* parents = rig.getParentIndices();
+
+		// weight of each clip within its layer, clips that cannot drive this
+		// rig get none
+		float clipWeights[Animator::MAX_LAYERS][AnimationLayer::MAX_CLIPS] = {};
+
+		for (uint32 l = 0; l < animator.numLayers; ++l) {
+			AnimationLayer& layer = animator.layers[l];
+			float weightSum = 0.f;
+
+			for (uint32 c = 0; c < layer.numClips; ++c) {
+				AnimationClipState& clip = layer.clips[c];
+
+				if (clip.animation->getNumBones() != numBones || clip.weight <= 0.f) {
+					continue;
+				}
+
+				if (clip.keyCursors.size() != 3 * numBones) {
+					clip.keyCursors.assign(3 * numBones, 0);
+				}
+
+				clipWeights[l][c] = clip.weight;
+				weightSum += clip.weight;
+			}
+
+			for (uint32 c = 0; c < layer.numClips && weightSum > 0.f; ++c) {
+				clipWeights[l][c] /= weightSum;
+			}
+		}
+
+		if (modelTransforms.size() < numBones) {
+			modelTransforms.resize(numBones);
+		}
+
+		const Quaternion identity(1.f, 0.f, 0.f, 0.f);
+
+		uint32 numSkippedBones = 0;
+
+		// bones are sorted parent first, so every parent is final before its
+		// children read it
+		for (uint32 i = 0; i < numBones; ++i) {
+			if (skipLeafBones && rig.isLeafBone(i)) {
+				modelTransforms[i] = parents[i] < 0 ? localCache[i]
+						: modelTransforms[parents[i]] * localCache[i];
+
+				rig.setFinalTransform(i, rig.getGlobalInverseTransform()
+						* modelTransforms[i] * rig.getBone(i).localTransform);
+
+				++numSkippedBones;
+				continue;
+			}
+
+			Vector3f position(0.f, 0.f, 0.f);
+			Quaternion rotation = identity;
+			Vector3f scale(1.f, 1.f, 1.f);
+
+			for (uint32 l = 0; l < animator.numLayers; ++l) {
+				AnimationLayer& layer = animator.layers[l];
+				const bool additive = layer.blendMode == AnimationBlendMode::ADDITIVE;
+				const float weight = layer.mask ? layer.weight * layer.mask->getWeight(i)
+						: layer.weight;
+
+				if (weight <= 0.f) {
+					continue;
+				}
+
+				Vector3f layerPosition(0.f, 0.f, 0.f);
+				Quaternion layerRotation(0.f, 0.f, 0.f, 0.f);
+				Vector3f layerScale(0.f, 0.f, 0.f);
+
+				bool sampled = false;
+
+				for (uint32 c = 0; c < layer.numClips; ++c) {
+					if (clipWeights[l][c] <= 0.f) {
+						continue;
+					}
+
+					AnimationClipState& clip = layer.clips[c];
+					const Animation& anim = *clip.animation;
+					uint32* cursors = clip.keyCursors.data() + 3 * i;
+
+					Vector3f p = anim.samplePosition(i, clip.time, cursors[0]);
+					Quaternion r = anim.sampleRotation(i, clip.time, cursors[1]);
+					Vector3f s = anim.sampleScale(i, clip.time, cursors[2]);
+
+					if (animator.applyRootMotion && !additive
+							&& anim.getRootMotionBone() == static_cast<int32>(i)) {
+						anim.getRootMotionReference(p, r);
+					}
+
+					if (additive) {
+						uint32 referenceCursor = 0;
+						p -= anim.samplePosition(i, 0.f, referenceCursor);
+
+						referenceCursor = 0;
+						r = Math::conjugate(anim.sampleRotation(i, 0.f, referenceCursor)) * r;
+
+						referenceCursor = 0;
+						s /= anim.sampleScale(i, 0.f, referenceCursor);
+					}
+
+					// keep the summed rotations in one hemisphere
+					if (Math::dot(layerRotation, r) < 0.f) {
+						r = -r;
+					}
+
+					layerPosition += p * clipWeights[l][c];
+					layerRotation += r * clipWeights[l][c];
+					layerScale += s * clipWeights[l][c];
+
+					sampled = true;
+				}
+
+				if (!sampled) {
+					continue;
+				}
+
+				layerRotation = Math::normalize(layerRotation);
+
+				if (additive) {
+					position += layerPosition * weight;
+					rotation = rotation * Math::slerp(identity, layerRotation, weight);
+					scale *= Math::mix(Vector3f(1.f, 1.f, 1.f), layerScale, weight);
+				}
+				else if (weight >= 1.f) {
+					position = layerPosition;
+					rotation = layerRotation;
+					scale = layerScale;
+				}
+				else {
+					position = Math::mix(position, layerPosition, weight);
+					rotation = Math::slerp(rotation, layerRotation, weight);
+					scale = Math::mix(scale, layerScale, weight);
+				}
+			}
+
+			const Matrix4f localTransform = Transform(position, rotation, scale).toMatrix();
+
+			if (localCache) {
+				localCache[i] = localTransform;
+			}
+
+			if (parents[i] < 0) {
+				modelTransforms[i] = localTransform;
+			}
+			else {
+				modelTransforms[i] = modelTransforms[parents[i]] * localTransform;
+			}
+
+			rig.setFinalTransform(i, rig.getGlobalInverseTransform()
+					* modelTransforms[i] * rig.getBone(i).localTransform);
+		}
+
+		stats.numSkippedBones += numSkippedBones;
+	}
 };
@@ -2,14 +2,34 @@
 
 #include <engine/ecs/ecs.hpp>
 #include <engine/rendering/render-system.hpp>
+#include <engine/rendering/vertex-array.hpp>
 
 #include <engine/components/transform-component.hpp>
 
 void renderRiggedMeshes(Registry& registry, RenderSystem& renderer) {
-    registry.view<TransformComponent, RiggedMesh>().each([&](auto& tfc, auto& rm) {
+    auto& culler = renderer.getFrustumCuller();
+    auto view = registry.view<TransformComponent, RiggedMesh>();
+
+    view.each([&](auto entity, auto& tfc, auto& rm) {
         if (rm.render) {
-            renderer.drawRiggedMesh(*rm.vertexArray, *rm.material, *rm.rig, 
-                    tfc.transform.toMatrix());
+            if (rm.vertexArray->hasBounds()) {
+                culler.add(static_cast<uint32>(entity), tfc.transform.toMatrix(),
+                        rm.vertexArray->getBounds());
+            }
+            else {
+                culler.add(static_cast<uint32>(entity), tfc.transform.toMatrix());
+            }
         }
     });
+
+    culler.cull();
+
+    for (uint32 i = 0; i < culler.getNumVisible(); ++i) {
+        auto& rm = view.template get<RiggedMesh>(static_cast<Entity>(culler.getVisibleID(i)));
+
+        renderer.drawRiggedMesh(*rm.vertexArray, *rm.material, *rm.rig,
+                culler.getVisibleTransform(i));
+    }
+
+    culler.clear();
 }
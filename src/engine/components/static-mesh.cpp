@@ -2,13 +2,34 @@
 
 #include <engine/ecs/ecs.hpp>
 #include <engine/rendering/render-system.hpp>
+#include <engine/rendering/vertex-array.hpp>
 
 #include <engine/components/transform-component.hpp>
 
 void renderStaticMeshes(Registry& registry, RenderSystem& renderer) {
-    registry.view<TransformComponent, StaticMesh>().each([&](auto& tfc, auto& sm) {
+    auto& culler = renderer.getFrustumCuller();
+    auto view = registry.view<TransformComponent, StaticMesh>();
+
+    view.each([&](auto entity, auto& tfc, auto& sm) {
         if (sm.render) {
-            renderer.drawStaticMesh(*sm.vertexArray, *sm.material, tfc.transform.toMatrix());
+            if (sm.vertexArray->hasBounds()) {
+                culler.add(static_cast<uint32>(entity), tfc.transform.toMatrix(),
+                        sm.vertexArray->getBounds());
+            }
+            else {
+                culler.add(static_cast<uint32>(entity), tfc.transform.toMatrix());
+            }
         }
     });
+
+    culler.cull();
+
+    for (uint32 i = 0; i < culler.getNumVisible(); ++i) {
+        auto& sm = view.template get<StaticMesh>(static_cast<Entity>(culler.getVisibleID(i)));
+
+        renderer.drawStaticMesh(*sm.vertexArray, *sm.material,
+                culler.getVisibleTransform(i));
+    }
+
+    culler.clear();
 }
@@ -0,0 +1,274 @@
+#include "engine/core/job-system.hpp"
+
+#define DEQUE_CAPACITY JobSystem::MAX_JOBS_PER_WORKER
+
+#define SPIN_COUNT 64
+
+namespace {
+	thread_local const JobSystem* currentSystem = nullptr;
+	thread_local uint32 currentWorker = (uint32)-1;
+
+	uint32 nextRandom(uint32& state);
+};
+
+JobSystem::JobSystem(uint32 numThreads)
+		: workers(nullptr)
+		, threads(nullptr)
+		, numWorkers(numThreads)
+		, running(true)
+		, numQueuedJobs(0)
+		, numSleeping(0) {
+	if (numWorkers == 0) {
+		numWorkers = std::thread::hardware_concurrency();
+	}
+
+	if (numWorkers == 0) {
+		numWorkers = 1;
+	}
+
+	workers = new Worker[numWorkers];
+
+	for (uint32 i = 0; i < numWorkers; ++i) {
+		workers[i].randomState = 0x9E3779B9u * (i + 1);
+	}
+
+	currentSystem = this;
+	currentWorker = 0;
+
+	threads = new std::thread[numWorkers - 1];
+
+	for (uint32 i = 1; i < numWorkers; ++i) {
+		threads[i - 1] = std::thread(&JobSystem::workerLoop, this, i);
+	}
+}
+
+void JobSystem::run(JobFunction function, void* data, JobCounter* counter,
+		uint32 begin, uint32 end) {
+	const uint32 workerIndex = getCurrentWorker();
+
+	if (workerIndex == (uint32)-1) {
+		function(data, begin, end);
+		return;
+	}
+
+	if (counter) {
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const Job job = {function, data, counter, begin, end};
+
+	numQueuedJobs.fetch_add(1);
+
+	if (!workers[workerIndex].deque.push(job)) {
+		// deque is full, keep the caller busy instead of growing it
+		numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		execute(job);
+
+		return;
+	}
+
+	if (numSleeping.load() > 0) {
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		sleepCondition.notify_one();
+	}
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+	const uint32 workerIndex = getCurrentWorker();
+
+	while (!counter.isDone()) {
+		if (workerIndex == (uint32)-1 || !executeNext(workerIndex)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+uint32 JobSystem::getCurrentWorker() const {
+	return currentSystem == this ? currentWorker : (uint32)-1;
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+
+	sleepCondition.notify_all();
+
+	for (uint32 i = 0; i < numWorkers - 1; ++i) {
+		threads[i].join();
+	}
+
+	if (currentSystem == this) {
+		currentSystem = nullptr;
+		currentWorker = (uint32)-1;
+	}
+
+	delete[] threads;
+	delete[] workers;
+}
+
+void JobSystem::workerLoop(uint32 workerIndex) {
+	currentSystem = this;
+	currentWorker = workerIndex;
+
+	uint32 numFailed = 0;
+
+	while (running.load(std::memory_order_relaxed)) {
+		if (executeNext(workerIndex)) {
+			numFailed = 0;
+			continue;
+		}
+
+		if (++numFailed < SPIN_COUNT) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+
+		++numSleeping;
+		sleepCondition.wait(lock, [&] {
+			return numQueuedJobs.load() > 0 || !running;
+		});
+		--numSleeping;
+
+		numFailed = 0;
+	}
+}
+
+bool JobSystem::executeNext(uint32 workerIndex) {
+	Worker& worker = workers[workerIndex];
+
+	Job job;
+	bool found = worker.deque.take(job);
+
+	if (!found) {
+		const uint32 first = ::nextRandom(worker.randomState) % numWorkers;
+
+		for (uint32 i = 0; i < numWorkers && !found; ++i) {
+			const uint32 victim = (first + i) % numWorkers;
+
+			if (victim != workerIndex) {
+				found = workers[victim].deque.steal(job);
+			}
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+	execute(job);
+
+	return true;
+}
+
+void JobSystem::execute(const Job& job) {
+	job.function(job.data, job.begin, job.end);
+
+	if (job.counter) {
+		job.counter->value.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+// Chase-Lev deque with the memory orderings from Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models". Fixed size, push fails
+// when full.
+JobSystem::JobDeque::JobDeque()
+		: top(0)
+		, bottom(0)
+		, buffer(new JobSlot[DEQUE_CAPACITY]) {}
+
+bool JobSystem::JobDeque::push(const Job& job) {
+	const int64 b = bottom.load(std::memory_order_relaxed);
+	const int64 t = top.load(std::memory_order_acquire);
+
+	if (b - t >= (int64)DEQUE_CAPACITY) {
+		return false;
+	}
+
+	store(buffer[b & (DEQUE_CAPACITY - 1)], job);
+
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+
+	return true;
+}
+
+bool JobSystem::JobDeque::take(Job& job) {
+	const int64 b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	int64 t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	load(buffer[b & (DEQUE_CAPACITY - 1)], job);
+
+	if (t == b) {
+		// last job, race any thief for it
+		const bool won = top.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+
+		return won;
+	}
+
+	return true;
+}
+
+bool JobSystem::JobDeque::steal(Job& job) {
+	int64 t = top.load(std::memory_order_acquire);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	const int64 b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return false;
+	}
+
+	load(buffer[t & (DEQUE_CAPACITY - 1)], job);
+
+	return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+			std::memory_order_relaxed);
+}
+
+JobSystem::JobDeque::~JobDeque() {
+	delete[] buffer;
+}
+
+void JobSystem::JobDeque::store(JobSlot& slot, const Job& job) {
+	slot.function.store(job.function, std::memory_order_relaxed);
+	slot.data.store(job.data, std::memory_order_relaxed);
+	slot.counter.store(job.counter, std::memory_order_relaxed);
+	slot.begin.store(job.begin, std::memory_order_relaxed);
+	slot.end.store(job.end, std::memory_order_relaxed);
+}
+
+void JobSystem::JobDeque::load(const JobSlot& slot, Job& job) {
+	job.function = slot.function.load(std::memory_order_relaxed);
+	job.data = slot.data.load(std::memory_order_relaxed);
+	job.counter = slot.counter.load(std::memory_order_relaxed);
+	job.begin = slot.begin.load(std::memory_order_relaxed);
+	job.end = slot.end.load(std::memory_order_relaxed);
+}
+
+namespace {
+	uint32 nextRandom(uint32& state) {
+		// xorshift32
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		return state;
+	}
+};
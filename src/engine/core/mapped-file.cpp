@@ -0,0 +1,117 @@
+#include "engine/core/mapped-file.hpp"
+
+#include <engine/core/string.hpp>
+
+#if defined(OPERATING_SYSTEM_WINDOWS)
+
+#define NOMINMAX
+#include <windows.h>
+
+bool MappedFile::open(const StringView& fileName) {
+	close();
+
+	const String name(fileName.data(), fileName.size());
+
+	HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+
+	if (!mapping) {
+		return false;
+	}
+
+	data = static_cast<const uint8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!data) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	size = static_cast<uintptr>(fileSize.QuadPart);
+	handle = mapping;
+
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) {
+		UnmapViewOfFile(data);
+		CloseHandle(static_cast<HANDLE>(handle));
+	}
+
+	data = nullptr;
+	size = 0;
+	handle = nullptr;
+}
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool MappedFile::open(const StringView& fileName) {
+	close();
+
+	const String name(fileName.data(), fileName.size());
+	const int fd = ::open(name.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat fileStat;
+
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	data = static_cast<const uint8*>(mapping);
+	size = static_cast<uintptr>(fileStat.st_size);
+
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) {
+		munmap(const_cast<uint8*>(data), size);
+	}
+
+	data = nullptr;
+	size = 0;
+}
+
+#endif
+
+void MappedFile::prefetch() const {
+	constexpr const uintptr PREFETCH_STRIDE = 4096;
+
+	volatile uint8 sink = 0;
+
+	for (uintptr i = 0; i < size; i += PREFETCH_STRIDE) {
+		sink = sink + data[i];
+	}
+}
@@ -23,7 +23,7 @@ AABB::AABB(const Vector3f* points, uint32 amt) {
 	}
 }
 
-AABB::AABB(float* points, uint32 amt, uint32 stride) {
+AABB::AABB(const float* points, uint32 amt, uint32 stride) {
 	if (amt == 0) {
 		extents[0] = Vector3f(0.f, 0.f, 0.f);
 		extents[1] = Vector3f(0.f, 0.f, 0.f);
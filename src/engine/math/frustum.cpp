@@ -0,0 +1,197 @@
+#include "engine/math/frustum.hpp"
+
+#include <engine/math/math.hpp>
+
+#include <immintrin.h>
+
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+	#define FRUSTUM_AVX_DISPATCH
+#endif
+
+static uint32 intersectsAABBs4(const Vector4f* planes, const float* centerX,
+		const float* centerY, const float* centerZ, const float* extentX,
+		const float* extentY, const float* extentZ, uint32 count,
+		uint32* visibleIndices, uint32 start);
+
+#ifdef FRUSTUM_AVX_DISPATCH
+static uint32 intersectsAABBs8(const Vector4f* planes, const float* centerX,
+		const float* centerY, const float* centerZ, const float* extentX,
+		const float* extentY, const float* extentZ, uint32 count,
+		uint32* visibleIndices);
+#endif
+
+Frustum::Frustum(const Matrix4f& viewProjection) {
+	// Gribb/Hartmann plane extraction, rows of the column-major matrix
+	const Vector4f row0(viewProjection[0][0], viewProjection[1][0],
+			viewProjection[2][0], viewProjection[3][0]);
+	const Vector4f row1(viewProjection[0][1], viewProjection[1][1],
+			viewProjection[2][1], viewProjection[3][1]);
+	const Vector4f row2(viewProjection[0][2], viewProjection[1][2],
+			viewProjection[2][2], viewProjection[3][2]);
+	const Vector4f row3(viewProjection[0][3], viewProjection[1][3],
+			viewProjection[2][3], viewProjection[3][3]);
+
+	planes[PLANE_LEFT] = row3 + row0;
+	planes[PLANE_RIGHT] = row3 - row0;
+	planes[PLANE_BOTTOM] = row3 + row1;
+	planes[PLANE_TOP] = row3 - row1;
+	planes[PLANE_NEAR] = row3 + row2;
+	planes[PLANE_FAR] = row3 - row2;
+
+	for (uint32 i = 0; i < NUM_PLANES; ++i) {
+		planes[i] /= Math::length(Vector3f(planes[i]));
+	}
+}
+
+bool Frustum::intersects(const AABB& aabb) const {
+	Vector3f center, extents;
+	aabb.getCenterAndExtents(center, extents);
+
+	for (uint32 i = 0; i < NUM_PLANES; ++i) {
+		const Vector3f normal(planes[i]);
+
+		const float d = Math::dot(normal, center) + planes[i].w;
+		const float r = Math::dot(glm::abs(normal), extents);
+
+		if (d + r < 0.f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32 Frustum::intersectsAABBs(const float* centerX, const float* centerY,
+		const float* centerZ, const float* extentX, const float* extentY,
+		const float* extentZ, uint32 count, uint32* visibleIndices) const {
+#ifdef FRUSTUM_AVX_DISPATCH
+	static const bool hasAVX = __builtin_cpu_supports("avx");
+
+	if (hasAVX) {
+		return intersectsAABBs8(planes, centerX, centerY, centerZ,
+				extentX, extentY, extentZ, count, visibleIndices);
+	}
+#endif
+
+	return intersectsAABBs4(planes, centerX, centerY, centerZ,
+			extentX, extentY, extentZ, count, visibleIndices, 0);
+}
+
+static uint32 intersectsAABBs4(const Vector4f* planes, const float* centerX,
+		const float* centerY, const float* centerZ, const float* extentX,
+		const float* extentY, const float* extentZ, uint32 count,
+		uint32* visibleIndices, uint32 start) {
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32 numVisible = 0;
+	uint32 i = start;
+
+	for (; i + 4 <= count; i += 4) {
+		const __m128 cx = _mm_loadu_ps(centerX + i);
+		const __m128 cy = _mm_loadu_ps(centerY + i);
+		const __m128 cz = _mm_loadu_ps(centerZ + i);
+		const __m128 ex = _mm_loadu_ps(extentX + i);
+		const __m128 ey = _mm_loadu_ps(extentY + i);
+		const __m128 ez = _mm_loadu_ps(extentZ + i);
+
+		__m128 outside = zero;
+
+		for (uint32 p = 0; p < Frustum::NUM_PLANES; ++p) {
+			const __m128 nx = _mm_set1_ps(planes[p].x);
+			const __m128 ny = _mm_set1_ps(planes[p].y);
+			const __m128 nz = _mm_set1_ps(planes[p].z);
+
+			const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx),
+					_mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz),
+					_mm_set1_ps(planes[p].w)));
+			const __m128 r = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+					_mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+					_mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+		}
+
+		const int32 outsideMask = _mm_movemask_ps(outside);
+
+		for (uint32 j = 0; j < 4; ++j) {
+			if (!(outsideMask & (1 << j))) {
+				visibleIndices[numVisible++] = i + j;
+			}
+		}
+	}
+
+	for (; i < count; ++i) {
+		bool visible = true;
+
+		for (uint32 p = 0; p < Frustum::NUM_PLANES && visible; ++p) {
+			const float d = planes[p].x * centerX[i] + planes[p].y * centerY[i]
+					+ planes[p].z * centerZ[i] + planes[p].w;
+			const float r = Math::abs(planes[p].x) * extentX[i]
+					+ Math::abs(planes[p].y) * extentY[i]
+					+ Math::abs(planes[p].z) * extentZ[i];
+
+			visible = d + r >= 0.f;
+		}
+
+		if (visible) {
+			visibleIndices[numVisible++] = i;
+		}
+	}
+
+	return numVisible;
+}
+
+#ifdef FRUSTUM_AVX_DISPATCH
+__attribute__((target("avx")))
+static uint32 intersectsAABBs8(const Vector4f* planes, const float* centerX,
+		const float* centerY, const float* centerZ, const float* extentX,
+		const float* extentY, const float* extentZ, uint32 count,
+		uint32* visibleIndices) {
+	const __m256 signMask = _mm256_set1_ps(-0.f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	uint32 numVisible = 0;
+	uint32 i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		const __m256 cx = _mm256_loadu_ps(centerX + i);
+		const __m256 cy = _mm256_loadu_ps(centerY + i);
+		const __m256 cz = _mm256_loadu_ps(centerZ + i);
+		const __m256 ex = _mm256_loadu_ps(extentX + i);
+		const __m256 ey = _mm256_loadu_ps(extentY + i);
+		const __m256 ez = _mm256_loadu_ps(extentZ + i);
+
+		__m256 outside = zero;
+
+		for (uint32 p = 0; p < Frustum::NUM_PLANES; ++p) {
+			const __m256 nx = _mm256_set1_ps(planes[p].x);
+			const __m256 ny = _mm256_set1_ps(planes[p].y);
+			const __m256 nz = _mm256_set1_ps(planes[p].z);
+
+			const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx),
+					_mm256_mul_ps(ny, cy)), _mm256_add_ps(_mm256_mul_ps(nz, cz),
+					_mm256_set1_ps(planes[p].w)));
+			const __m256 r = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, nx), ex),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, ny), ey)),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez));
+
+			outside = _mm256_or_ps(outside,
+					_mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+		}
+
+		const int32 outsideMask = _mm256_movemask_ps(outside);
+
+		for (uint32 j = 0; j < 8; ++j) {
+			if (!(outsideMask & (1 << j))) {
+				visibleIndices[numVisible++] = i + j;
+			}
+		}
+	}
+
+	return numVisible + intersectsAABBs4(planes, centerX, centerY, centerZ,
+			extentX, extentY, extentZ, count, visibleIndices + numVisible, i);
+}
+#endif
@@ -0,0 +1,268 @@
+#include "engine/math/intersects.hpp"
+
+#include <engine/math/math.hpp>
+
+#include <immintrin.h>
+
+#define TRIANGLE_EPSILON 0.00001f
+
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+	#define INTERSECTS_AVX_DISPATCH
+#endif
+
+static uint32 intersectTriangles4(const Vector3f& pos, const Vector3f& dir,
+		const Intersects::TriangleStreams& triangles, uint32 start,
+		uint32 count, float& t, uint32 closest);
+
+#ifdef INTERSECTS_AVX_DISPATCH
+static uint32 intersectTriangles8(const Vector3f& pos, const Vector3f& dir,
+		const Intersects::TriangleStreams& triangles, uint32 count, float& t);
+#endif
+
+uint32 Intersects::intersectTriangles(const Vector3f& pos, const Vector3f& dir,
+		const TriangleStreams& triangles, uint32 count, float& t) {
+#ifdef INTERSECTS_AVX_DISPATCH
+	static const bool hasAVX = __builtin_cpu_supports("avx");
+
+	if (hasAVX) {
+		return intersectTriangles8(pos, dir, triangles, count, t);
+	}
+#endif
+
+	return intersectTriangles4(pos, dir, triangles, 0, count, t, (uint32)-1);
+}
+
+static uint32 intersectTriangles4(const Vector3f& pos, const Vector3f& dir,
+		const Intersects::TriangleStreams& triangles, uint32 start,
+		uint32 count, float& t, uint32 closest) {
+	const float* v0x = triangles.v0[0];
+	const float* v0y = triangles.v0[1];
+	const float* v0z = triangles.v0[2];
+	const float* e1x = triangles.e1[0];
+	const float* e1y = triangles.e1[1];
+	const float* e1z = triangles.e1[2];
+	const float* e2x = triangles.e2[0];
+	const float* e2y = triangles.e2[1];
+	const float* e2z = triangles.e2[2];
+
+	uint32 i = start;
+
+	if (i + 4 <= count) {
+		const __m128 signMask = _mm_set1_ps(-0.f);
+		const __m128 epsilon = _mm_set1_ps(TRIANGLE_EPSILON);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+
+		const __m128 px = _mm_set1_ps(pos.x);
+		const __m128 py = _mm_set1_ps(pos.y);
+		const __m128 pz = _mm_set1_ps(pos.z);
+		const __m128 dx = _mm_set1_ps(dir.x);
+		const __m128 dy = _mm_set1_ps(dir.y);
+		const __m128 dz = _mm_set1_ps(dir.z);
+
+		// per lane closest hit, lanes only ever see increasing indices
+		__m128 bestT = _mm_set1_ps(t);
+		__m128i bestIndex = _mm_set1_epi32(-1);
+		__m128i index = _mm_setr_epi32(i, i + 1, i + 2, i + 3);
+
+		for (; i + 4 <= count; i += 4) {
+			const __m128 ax = _mm_loadu_ps(e1x + i);
+			const __m128 ay = _mm_loadu_ps(e1y + i);
+			const __m128 az = _mm_loadu_ps(e1z + i);
+			const __m128 bx = _mm_loadu_ps(e2x + i);
+			const __m128 by = _mm_loadu_ps(e2y + i);
+			const __m128 bz = _mm_loadu_ps(e2z + i);
+
+			const __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, bz), _mm_mul_ps(dz, by));
+			const __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, bx), _mm_mul_ps(dx, bz));
+			const __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, by), _mm_mul_ps(dy, bx));
+
+			const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, hx),
+					_mm_mul_ps(ay, hy)), _mm_mul_ps(az, hz));
+			const __m128 f = _mm_div_ps(one, a);
+
+			const __m128 sx = _mm_sub_ps(px, _mm_loadu_ps(v0x + i));
+			const __m128 sy = _mm_sub_ps(py, _mm_loadu_ps(v0y + i));
+			const __m128 sz = _mm_sub_ps(pz, _mm_loadu_ps(v0z + i));
+
+			const __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx),
+					_mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+
+			const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, az), _mm_mul_ps(sz, ay));
+			const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, ax), _mm_mul_ps(sx, az));
+			const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, ay), _mm_mul_ps(sy, ax));
+
+			const __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+					_mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+			const __m128 triT = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(bx, qx), _mm_mul_ps(by, qy)), _mm_mul_ps(bz, qz)));
+
+			__m128 hit = _mm_cmpge_ps(_mm_andnot_ps(signMask, a), epsilon);
+			hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(u, one));
+			hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			hit = _mm_and_ps(hit, _mm_cmpgt_ps(triT, epsilon));
+			hit = _mm_and_ps(hit, _mm_cmplt_ps(triT, bestT));
+
+			bestT = _mm_or_ps(_mm_and_ps(hit, triT), _mm_andnot_ps(hit, bestT));
+
+			const __m128i hitMask = _mm_castps_si128(hit);
+			bestIndex = _mm_or_si128(_mm_and_si128(hitMask, index),
+					_mm_andnot_si128(hitMask, bestIndex));
+
+			index = _mm_add_epi32(index, _mm_set1_epi32(4));
+		}
+
+		alignas(16) float laneT[4];
+		alignas(16) uint32 laneIndex[4];
+
+		_mm_store_ps(laneT, bestT);
+		_mm_store_si128((__m128i*)laneIndex, bestIndex);
+
+		// lowest index wins ties so the result matches a sequential scan
+		for (uint32 j = 0; j < 4; ++j) {
+			if (laneIndex[j] != (uint32)-1 && (laneT[j] < t
+					|| (laneT[j] == t && laneIndex[j] < closest))) {
+				t = laneT[j];
+				closest = laneIndex[j];
+			}
+		}
+	}
+
+	for (; i < count; ++i) {
+		const Vector3f e1(e1x[i], e1y[i], e1z[i]);
+		const Vector3f e2(e2x[i], e2y[i], e2z[i]);
+
+		const Vector3f h = Math::cross(dir, e2);
+		const float a = Math::dot(e1, h);
+
+		if (a > -TRIANGLE_EPSILON && a < TRIANGLE_EPSILON) {
+			continue;
+		}
+
+		const float f = 1.f / a;
+
+		const Vector3f s = pos - Vector3f(v0x[i], v0y[i], v0z[i]);
+		const float u = f * Math::dot(s, h);
+
+		if (u < 0.f || u > 1.f) {
+			continue;
+		}
+
+		const Vector3f q = Math::cross(s, e1);
+		const float v = f * Math::dot(dir, q);
+
+		if (v < 0.f || u + v > 1.f) {
+			continue;
+		}
+
+		const float triT = f * Math::dot(e2, q);
+
+		if (triT > TRIANGLE_EPSILON && triT < t) {
+			t = triT;
+			closest = i;
+		}
+	}
+
+	return closest;
+}
+
+#ifdef INTERSECTS_AVX_DISPATCH
+__attribute__((target("avx")))
+static uint32 intersectTriangles8(const Vector3f& pos, const Vector3f& dir,
+		const Intersects::TriangleStreams& triangles, uint32 count, float& t) {
+	uint32 closest = (uint32)-1;
+	uint32 i = 0;
+
+	if (count >= 8) {
+		const __m256 signMask = _mm256_set1_ps(-0.f);
+		const __m256 epsilon = _mm256_set1_ps(TRIANGLE_EPSILON);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.f);
+
+		const __m256 px = _mm256_set1_ps(pos.x);
+		const __m256 py = _mm256_set1_ps(pos.y);
+		const __m256 pz = _mm256_set1_ps(pos.z);
+		const __m256 dx = _mm256_set1_ps(dir.x);
+		const __m256 dy = _mm256_set1_ps(dir.y);
+		const __m256 dz = _mm256_set1_ps(dir.z);
+
+		__m256 bestT = _mm256_set1_ps(t);
+		__m256 bestIndex = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (; i + 8 <= count; i += 8) {
+			const __m256 ax = _mm256_loadu_ps(triangles.e1[0] + i);
+			const __m256 ay = _mm256_loadu_ps(triangles.e1[1] + i);
+			const __m256 az = _mm256_loadu_ps(triangles.e1[2] + i);
+			const __m256 bx = _mm256_loadu_ps(triangles.e2[0] + i);
+			const __m256 by = _mm256_loadu_ps(triangles.e2[1] + i);
+			const __m256 bz = _mm256_loadu_ps(triangles.e2[2] + i);
+
+			const __m256 hx = _mm256_sub_ps(_mm256_mul_ps(dy, bz),
+					_mm256_mul_ps(dz, by));
+			const __m256 hy = _mm256_sub_ps(_mm256_mul_ps(dz, bx),
+					_mm256_mul_ps(dx, bz));
+			const __m256 hz = _mm256_sub_ps(_mm256_mul_ps(dx, by),
+					_mm256_mul_ps(dy, bx));
+
+			const __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, hx),
+					_mm256_mul_ps(ay, hy)), _mm256_mul_ps(az, hz));
+			const __m256 f = _mm256_div_ps(one, a);
+
+			const __m256 sx = _mm256_sub_ps(px, _mm256_loadu_ps(triangles.v0[0] + i));
+			const __m256 sy = _mm256_sub_ps(py, _mm256_loadu_ps(triangles.v0[1] + i));
+			const __m256 sz = _mm256_sub_ps(pz, _mm256_loadu_ps(triangles.v0[2] + i));
+
+			const __m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)),
+					_mm256_mul_ps(sz, hz)));
+
+			const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, az),
+					_mm256_mul_ps(sz, ay));
+			const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, ax),
+					_mm256_mul_ps(sx, az));
+			const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, ay),
+					_mm256_mul_ps(sy, ax));
+
+			const __m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)),
+					_mm256_mul_ps(dz, qz)));
+			const __m256 triT = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(bx, qx), _mm256_mul_ps(by, qy)),
+					_mm256_mul_ps(bz, qz)));
+
+			__m256 hit = _mm256_cmp_ps(_mm256_andnot_ps(signMask, a), epsilon,
+					_CMP_GE_OQ);
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one,
+					_CMP_LE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(triT, epsilon, _CMP_GT_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(triT, bestT, _CMP_LT_OQ));
+
+			bestT = _mm256_blendv_ps(bestT, triT, hit);
+			bestIndex = _mm256_blendv_ps(bestIndex, _mm256_castsi256_ps(
+					_mm256_setr_epi32(i, i + 1, i + 2, i + 3, i + 4, i + 5,
+					i + 6, i + 7)), hit);
+		}
+
+		alignas(32) float laneT[8];
+		alignas(32) uint32 laneIndex[8];
+
+		_mm256_store_ps(laneT, bestT);
+		_mm256_store_ps((float*)laneIndex, bestIndex);
+
+		for (uint32 j = 0; j < 8; ++j) {
+			if (laneIndex[j] != (uint32)-1 && (laneT[j] < t
+					|| (laneT[j] == t && laneIndex[j] < closest))) {
+				t = laneT[j];
+				closest = laneIndex[j];
+			}
+		}
+	}
+
+	return intersectTriangles4(pos, dir, triangles, i, count, t, closest);
+}
+#endif
@@ -0,0 +1,31 @@
+#include "engine/math/sphere.hpp"
+
+#include "engine/math/aabb.hpp"
+#include "engine/math/math.hpp"
+
+Sphere::Sphere(const float* points, uint32 amt, uint32 stride)
+		: center(0.f, 0.f, 0.f)
+		, radius(0.f) {
+	if (amt == 0) {
+		return;
+	}
+
+	// centered on the bounding box, radius reaches the farthest point
+	center = AABB(points, amt, stride).getCenter();
+
+	float maxDistSq = 0.f;
+
+	uintptr index = 0;
+	stride += 3;
+
+	for (uint32 i = 0; i < amt; ++i) {
+		const Vector3f d = Vector3f(points[index], points[index + 1],
+				points[index + 2]) - center;
+
+		maxDistSq = Math::max(maxDistSq, Math::dot(d, d));
+
+		index += stride;
+	}
+
+	radius = Math::sqrt(maxDistSq);
+}
@@ -0,0 +1,390 @@
+#include "engine/math/triangle-bvh.hpp"
+
+#include <engine/math/math.hpp>
+#include <engine/math/intersects.hpp>
+
+#include <algorithm>
+#include <cfloat>
+
+#define NUM_SAH_BINS 12
+#define MAX_TRAVERSAL_DEPTH 64
+
+namespace {
+	struct BuildTriangle {
+		Vector3f minExtents;
+		Vector3f maxExtents;
+		Vector3f centroid;
+		uint32 index;
+	};
+
+	struct Bin {
+		Vector3f minExtents = Vector3f(FLT_MAX);
+		Vector3f maxExtents = Vector3f(-FLT_MAX);
+		uint32 count = 0;
+	};
+
+	struct PacketEntry {
+		uint32 node;
+		uint32 rayMask;
+	};
+
+	float surfaceArea(const Vector3f& minExtents, const Vector3f& maxExtents);
+
+	void buildNode(ArrayList<TriangleBVH::Node>& nodes,
+			ArrayList<BuildTriangle>& triangles, uint32 nodeIndex,
+			uint32 first, uint32 count, uint32 depth);
+
+	bool intersectNode(const TriangleBVH::Node& node, const Vector3f& pos,
+			const Vector3f& invDir, float maxT, float& tNear);
+};
+
+TriangleBVH::TriangleBVH(const float* positions, const uint32* indices,
+		uint32 numIndices) {
+	const uint32 numTriangles = numIndices / 3;
+
+	ArrayList<BuildTriangle> buildTriangles(numTriangles);
+
+	for (uint32 i = 0; i < numTriangles; ++i) {
+		const Vector3f& v0 = *((const Vector3f*)&positions[3 * indices[3 * i]]);
+		const Vector3f& v1 = *((const Vector3f*)&positions[3 * indices[3 * i + 1]]);
+		const Vector3f& v2 = *((const Vector3f*)&positions[3 * indices[3 * i + 2]]);
+
+		auto& bt = buildTriangles[i];
+		bt.minExtents = Math::min(v0, Math::min(v1, v2));
+		bt.maxExtents = Math::max(v0, Math::max(v1, v2));
+		bt.centroid = (v0 + v1 + v2) * (1.f / 3.f);
+		bt.index = i;
+	}
+
+	nodes.reserve(2 * (numTriangles / MAX_LEAF_SIZE + 1));
+	nodes.emplace_back();
+
+	::buildNode(nodes, buildTriangles, 0, 0, numTriangles, 0);
+
+	triangleData.resize(9 * numTriangles);
+	triangleIDs.reserve(numTriangles);
+
+	for (uint32 j = 0; j < numTriangles; ++j) {
+		const uint32 i = buildTriangles[j].index;
+
+		const Vector3f& v0 = *((const Vector3f*)&positions[3 * indices[3 * i]]);
+		const Vector3f& v1 = *((const Vector3f*)&positions[3 * indices[3 * i + 1]]);
+		const Vector3f& v2 = *((const Vector3f*)&positions[3 * indices[3 * i + 2]]);
+
+		const Vector3f e1 = v1 - v0;
+		const Vector3f e2 = v2 - v0;
+
+		for (uint32 k = 0; k < 3; ++k) {
+			triangleData[k * numTriangles + j] = v0[k];
+			triangleData[(3 + k) * numTriangles + j] = e1[k];
+			triangleData[(6 + k) * numTriangles + j] = e2[k];
+		}
+
+		triangleIDs.push_back(i);
+	}
+}
+
+uint32 TriangleBVH::intersectRay(const Vector3f& pos, const Vector3f& dir,
+		float& t) const {
+	uint32 stack[MAX_TRAVERSAL_DEPTH];
+	uint32 stackSize = 0;
+
+	uint32 closest = (uint32)-1;
+	float minT = FLT_MAX;
+	float tNear, tNearRight;
+
+	if (triangleIDs.empty()) {
+		return closest;
+	}
+
+	const Vector3f invDir = 1.f / dir;
+
+	if (::intersectNode(nodes[0], pos, invDir, minT, tNear)) {
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+
+		if (node.count > 0) {
+			const uint32 hit = Intersects::intersectTriangles(pos, dir,
+					getStreams(node.offset), node.count, minT);
+
+			if (hit != (uint32)-1) {
+				closest = triangleIDs[node.offset + hit];
+			}
+
+			continue;
+		}
+
+		const uint32 left = static_cast<uint32>(&node - nodes.data()) + 1;
+		const uint32 right = node.offset;
+
+		const bool hitLeft = ::intersectNode(nodes[left], pos, invDir, minT, tNear);
+		const bool hitRight = ::intersectNode(nodes[right], pos, invDir, minT,
+				tNearRight);
+
+		// push the farther child first so the nearer one is visited next
+		if (hitLeft && hitRight) {
+			if (tNear <= tNearRight) {
+				stack[stackSize++] = right;
+				stack[stackSize++] = left;
+			}
+			else {
+				stack[stackSize++] = left;
+				stack[stackSize++] = right;
+			}
+		}
+		else if (hitLeft) {
+			stack[stackSize++] = left;
+		}
+		else if (hitRight) {
+			stack[stackSize++] = right;
+		}
+	}
+
+	t = minT;
+
+	return closest;
+}
+
+void TriangleBVH::intersectRays(const Vector3f* positions,
+		const Vector3f* directions, uint32 numRays, float* ts,
+		uint32* triangles) const {
+	for (uint32 i = 0; i < numRays; i += MAX_RAYS_PER_PACKET) {
+		intersectPacket(positions + i, directions + i,
+				Math::min(numRays - i, MAX_RAYS_PER_PACKET), ts + i, triangles + i);
+	}
+}
+
+void TriangleBVH::intersectPacket(const Vector3f* positions,
+		const Vector3f* directions, uint32 numRays, float* ts,
+		uint32* triangles) const {
+	Vector3f invDirs[MAX_RAYS_PER_PACKET];
+	PacketEntry stack[MAX_TRAVERSAL_DEPTH];
+	uint32 stackSize = 0;
+
+	uint32 rayMask = 0;
+	float tNear;
+
+	for (uint32 r = 0; r < numRays; ++r) {
+		invDirs[r] = 1.f / directions[r];
+		ts[r] = FLT_MAX;
+		triangles[r] = (uint32)-1;
+
+		if (!triangleIDs.empty() && ::intersectNode(nodes[0], positions[r],
+				invDirs[r], FLT_MAX, tNear)) {
+			rayMask |= 1u << r;
+		}
+	}
+
+	if (rayMask) {
+		stack[stackSize++] = {0, rayMask};
+	}
+
+	while (stackSize > 0) {
+		const PacketEntry entry = stack[--stackSize];
+		const Node& node = nodes[entry.node];
+
+		if (node.count > 0) {
+			const Intersects::TriangleStreams streams = getStreams(node.offset);
+
+			for (uint32 r = 0; r < numRays; ++r) {
+				if (!(entry.rayMask & (1u << r))) {
+					continue;
+				}
+
+				const uint32 hit = Intersects::intersectTriangles(positions[r],
+						directions[r], streams, node.count, ts[r]);
+
+				if (hit != (uint32)-1) {
+					triangles[r] = triangleIDs[node.offset + hit];
+				}
+			}
+
+			continue;
+		}
+
+		const uint32 children[] = {entry.node + 1, node.offset};
+		uint32 childMasks[2] = {0, 0};
+		float childNear[2] = {FLT_MAX, FLT_MAX};
+
+		for (uint32 c = 0; c < 2; ++c) {
+			for (uint32 r = 0; r < numRays; ++r) {
+				if ((entry.rayMask & (1u << r)) && ::intersectNode(nodes[children[c]],
+						positions[r], invDirs[r], ts[r], tNear)) {
+					childMasks[c] |= 1u << r;
+					childNear[c] = Math::min(childNear[c], tNear);
+				}
+			}
+		}
+
+		const uint32 first = childNear[0] <= childNear[1] ? 0 : 1;
+
+		if (childMasks[1 - first]) {
+			stack[stackSize++] = {children[1 - first], childMasks[1 - first]};
+		}
+
+		if (childMasks[first]) {
+			stack[stackSize++] = {children[first], childMasks[first]};
+		}
+	}
+}
+
+Intersects::TriangleStreams TriangleBVH::getStreams(uint32 offset) const {
+	const uint32 numTriangles = triangleIDs.size();
+	const float* data = triangleData.data() + offset;
+
+	Intersects::TriangleStreams streams;
+
+	for (uint32 k = 0; k < 3; ++k) {
+		streams.v0[k] = data + k * numTriangles;
+		streams.e1[k] = data + (3 + k) * numTriangles;
+		streams.e2[k] = data + (6 + k) * numTriangles;
+	}
+
+	return streams;
+}
+
+namespace {
+	float surfaceArea(const Vector3f& minExtents, const Vector3f& maxExtents) {
+		const Vector3f d = maxExtents - minExtents;
+		return 2.f * (d.x * d.y + d.x * d.z + d.y * d.z);
+	}
+
+	void buildNode(ArrayList<TriangleBVH::Node>& nodes,
+			ArrayList<BuildTriangle>& triangles, uint32 nodeIndex,
+			uint32 first, uint32 count, uint32 depth) {
+		Vector3f minExtents(FLT_MAX), maxExtents(-FLT_MAX);
+		Vector3f minCentroid(FLT_MAX), maxCentroid(-FLT_MAX);
+
+		for (uint32 i = first; i < first + count; ++i) {
+			minExtents = Math::min(minExtents, triangles[i].minExtents);
+			maxExtents = Math::max(maxExtents, triangles[i].maxExtents);
+			minCentroid = Math::min(minCentroid, triangles[i].centroid);
+			maxCentroid = Math::max(maxCentroid, triangles[i].centroid);
+		}
+
+		nodes[nodeIndex].minExtents = minExtents;
+		nodes[nodeIndex].maxExtents = maxExtents;
+		nodes[nodeIndex].offset = first;
+		nodes[nodeIndex].count = count;
+
+		// traversal stacks hold at most one entry per level plus one
+		if (count <= TriangleBVH::MAX_LEAF_SIZE || depth >= MAX_TRAVERSAL_DEPTH - 2) {
+			return;
+		}
+
+		// binned SAH over the triangle centroids
+		const Vector3f centroidExtents = maxCentroid - minCentroid;
+
+		float bestCost = FLT_MAX;
+		uint32 bestAxis = 0;
+		uint32 bestSplit = 0;
+
+		for (uint32 axis = 0; axis < 3; ++axis) {
+			if (centroidExtents[axis] <= 1e-6f) {
+				continue;
+			}
+
+			Bin bins[NUM_SAH_BINS];
+			const float binScale = NUM_SAH_BINS / centroidExtents[axis];
+
+			for (uint32 i = first; i < first + count; ++i) {
+				const uint32 b = Math::min(static_cast<uint32>((triangles[i].centroid[axis]
+						- minCentroid[axis]) * binScale), (uint32)(NUM_SAH_BINS - 1));
+
+				bins[b].minExtents = Math::min(bins[b].minExtents, triangles[i].minExtents);
+				bins[b].maxExtents = Math::max(bins[b].maxExtents, triangles[i].maxExtents);
+				++bins[b].count;
+			}
+
+			float rightAreas[NUM_SAH_BINS];
+			uint32 rightCounts[NUM_SAH_BINS];
+
+			Bin accum;
+
+			for (uint32 b = NUM_SAH_BINS - 1; b > 0; --b) {
+				accum.minExtents = Math::min(accum.minExtents, bins[b].minExtents);
+				accum.maxExtents = Math::max(accum.maxExtents, bins[b].maxExtents);
+				accum.count += bins[b].count;
+
+				rightAreas[b] = accum.count ? ::surfaceArea(accum.minExtents,
+						accum.maxExtents) : 0.f;
+				rightCounts[b] = accum.count;
+			}
+
+			accum = Bin();
+
+			for (uint32 b = 0; b < NUM_SAH_BINS - 1; ++b) {
+				accum.minExtents = Math::min(accum.minExtents, bins[b].minExtents);
+				accum.maxExtents = Math::max(accum.maxExtents, bins[b].maxExtents);
+				accum.count += bins[b].count;
+
+				if (accum.count == 0 || rightCounts[b + 1] == 0) {
+					continue;
+				}
+
+				const float cost = accum.count * ::surfaceArea(accum.minExtents,
+						accum.maxExtents) + rightCounts[b + 1] * rightAreas[b + 1];
+
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		uint32 mid;
+
+		if (bestCost == FLT_MAX) {
+			// all centroids coincide, split the range in half
+			mid = first + count / 2;
+		}
+		else {
+			if (bestCost >= count * ::surfaceArea(minExtents, maxExtents)
+					&& count <= 4 * TriangleBVH::MAX_LEAF_SIZE) {
+				return;
+			}
+
+			const float binScale = NUM_SAH_BINS / centroidExtents[bestAxis];
+			const float minCentroidAxis = minCentroid[bestAxis];
+
+			auto* it = std::partition(triangles.data() + first,
+					triangles.data() + first + count, [&](auto& bt) {
+				return Math::min(static_cast<uint32>((bt.centroid[bestAxis]
+						- minCentroidAxis) * binScale), (uint32)(NUM_SAH_BINS - 1))
+						< bestSplit;
+			});
+
+			mid = static_cast<uint32>(it - triangles.data());
+		}
+
+		nodes[nodeIndex].count = 0;
+
+		const uint32 left = nodes.size();
+		nodes.emplace_back();
+		::buildNode(nodes, triangles, left, first, mid - first, depth + 1);
+
+		const uint32 right = nodes.size();
+		nodes.emplace_back();
+		::buildNode(nodes, triangles, right, mid, first + count - mid, depth + 1);
+
+		nodes[nodeIndex].offset = right;
+	}
+
+	bool intersectNode(const TriangleBVH::Node& node, const Vector3f& pos,
+			const Vector3f& invDir, float maxT, float& tNear) {
+		const Vector3f t0 = (node.minExtents - pos) * invDir;
+		const Vector3f t1 = (node.maxExtents - pos) * invDir;
+
+		const Vector3f tMin = Math::min(t0, t1);
+		const Vector3f tMax = Math::max(t0, t1);
+
+		tNear = Math::max(Math::max(tMin.x, tMin.y), Math::max(tMin.z, 0.f));
+		const float tFar = Math::min(Math::min(tMax.x, tMax.y), Math::min(tMax.z, maxT));
+
+		return tNear <= tFar;
+	}
+};
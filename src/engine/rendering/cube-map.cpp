@@ -8,6 +8,9 @@ CubeMap::CubeMap(RenderContext& context, Bitmap* bitmaps,
 	for (uint32 i = 0; i < 6; ++i) {
 		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, bitmaps[i].getWidth(),
 				bitmaps[i].getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, bitmaps[i].getPixels());
+
+		memoryUsage += static_cast<uintptr>(bitmaps[i].getWidth())
+				* bitmaps[i].getHeight() * 4;
 	}
 }
 
@@ -70,6 +73,7 @@ bool CubeMap::load(const String* fileNames) {
 	internalFormat = GL_RGB;
 	compressed = false;
 	mipMaps = false;
+	memoryUsage = 0;
 
 	for (uint32 i = 0; i < 6; ++i) {
 		fileExtension = Util::getFileExtension(fileNames[i]).to_lower();
@@ -97,6 +101,8 @@ bool CubeMap::load(const String* fileNames) {
 
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, bmp.getWidth(),
 					bmp.getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, bmp.getPixels());
+
+			memoryUsage += static_cast<uintptr>(bmp.getWidth()) * bmp.getHeight() * 4;
 		}
 	}
 
@@ -113,7 +119,8 @@ inline CubeMap::CubeMap(RenderContext& context, uint32 internalFormat,
 		, textureID(0)
 		, internalFormat(internalFormat)
 		, compressed(compressed)
-		, mipMaps(mipMaps) {
+		, mipMaps(mipMaps)
+		, memoryUsage(0) {
 	initTexture();
 }
 
@@ -155,6 +162,8 @@ inline void CubeMap::initFromDDS(const DDSTexture& ddsTexture) {
 				h /= 2;
 			}
 		}
+
+		memoryUsage = offset;
 	}
 	else {
 		uint32 blockSize, dataType;
@@ -187,5 +196,7 @@ inline void CubeMap::initFromDDS(const DDSTexture& ddsTexture) {
 				h /= 2;
 			}
 		}
+
+		memoryUsage = offset;
 	}
 }
@@ -0,0 +1,64 @@
+#include "engine/rendering/draw-command-buffer.hpp"
+
+#include <algorithm>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+#define MIN_RADIX_SORT_SIZE 64
+
+void DrawCommandBuffer::sort() {
+	const size_t numCommands = commands.size();
+
+	if (numCommands < MIN_RADIX_SORT_SIZE) {
+		std::sort(commands.begin(), commands.end(), [](auto& a, auto& b) {
+			return a.sortKey < b.sortKey;
+		});
+
+		return;
+	}
+
+	sortBuffer.resize(numCommands);
+
+	size_t counts[RADIX_PASSES][RADIX_SIZE] = {};
+
+	for (size_t i = 0; i < numCommands; ++i) {
+		const uint64 key = commands[i].sortKey;
+
+		for (uint32 pass = 0; pass < RADIX_PASSES; ++pass) {
+			++counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)];
+		}
+	}
+
+	DrawCommand* src = commands.data();
+	DrawCommand* dst = sortBuffer.data();
+
+	for (uint32 pass = 0; pass < RADIX_PASSES; ++pass) {
+		const uint32 shift = pass * RADIX_BITS;
+		size_t* passCounts = counts[pass];
+
+		// every key shares this digit, the pass would be a plain copy
+		if (passCounts[(src[0].sortKey >> shift) & (RADIX_SIZE - 1)] == numCommands) {
+			continue;
+		}
+
+		size_t offset = 0;
+
+		for (uint32 i = 0; i < RADIX_SIZE; ++i) {
+			const size_t count = passCounts[i];
+			passCounts[i] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0; i < numCommands; ++i) {
+			dst[passCounts[(src[i].sortKey >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+
+	if (src != commands.data()) {
+		commands.swap(sortBuffer);
+	}
+}
@@ -138,6 +138,10 @@ const Font::Character& Font::getCharacter(char c) {
 	return characters[c];
 }
 
+uintptr Font::getMemoryUsage() const {
+	return texture.getMemoryUsage() + characters.size() * sizeof(Character);
+}
+
 Font::~Font() {
 }
 
@@ -0,0 +1,71 @@
+#include "engine/rendering/frustum-culler.hpp"
+
+void FrustumCuller::setFrustum(const Matrix4f& viewProjection) {
+	frustum = Frustum(viewProjection);
+}
+
+void FrustumCuller::add(uint32 id, const Matrix4f& transform,
+		const AABB& localBounds) {
+	const AABB worldBounds = localBounds.transform(transform);
+
+	Vector3f center, extents;
+	worldBounds.getCenterAndExtents(center, extents);
+
+	boundedCandidates.push_back(ids.size());
+
+	ids.push_back(id);
+	transforms.push_back(transform);
+
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+}
+
+void FrustumCuller::add(uint32 id, const Matrix4f& transform) {
+	visible.push_back(ids.size());
+
+	ids.push_back(id);
+	transforms.push_back(transform);
+
+	++stats.numVisible;
+}
+
+void FrustumCuller::cull() {
+	const uint32 numCandidates = boundedCandidates.size();
+	const uint32 visibleStart = visible.size();
+
+	visible.resize(visibleStart + numCandidates);
+
+	uint32* result = visible.data() + visibleStart;
+	const uint32 numVisible = frustum.intersectsAABBs(centerX.data(),
+			centerY.data(), centerZ.data(), extentX.data(), extentY.data(),
+			extentZ.data(), numCandidates, result);
+
+	for (uint32 i = 0; i < numVisible; ++i) {
+		result[i] = boundedCandidates[result[i]];
+	}
+
+	visible.resize(visibleStart + numVisible);
+
+	stats.numTested += numCandidates;
+	stats.numCulled += numCandidates - numVisible;
+	stats.numVisible += numVisible;
+}
+
+void FrustumCuller::clear() {
+	ids.endFrame();
+	transforms.endFrame();
+
+	centerX.endFrame();
+	centerY.endFrame();
+	centerZ.endFrame();
+	extentX.endFrame();
+	extentY.endFrame();
+	extentZ.endFrame();
+
+	boundedCandidates.endFrame();
+	visible.endFrame();
+}
@@ -1,11 +1,20 @@
 #include "engine/rendering/indexed-model.hpp"
 
 #include "engine/math/intersects.hpp"
+#include "engine/math/triangle-bvh.hpp"
+#include "engine/math/math.hpp"
 
 #include <cfloat>
+#include <atomic>
+
+#include <immintrin.h>
 
 #define EPSILON 1e-6f
 
+#define BVH_MIN_TRIANGLES 128
+#define TRIANGLE_BATCH_SIZE 64
+#define PLANE_BATCH_SIZE 4
+
 static float tetrahedronVolume(Vector3f& centroidSum, const Vector3f& p,
 		const Vector3f& v1, const Vector3f& v2, const Vector3f& v3);
 
@@ -15,79 +24,257 @@ static float clipTriangle(Vector3f& centroidSum, const Vector3f& p,
 
 IndexedModel::IndexedModel(const AllocationHints& hints)
 		: instancedElementStartIndex(hints.instancedElementStartIndex)
-		, flags(hints.flags) {
+		, flags(hints.flags)
+		, boundsValid(false) {
 	elementSizes.assign(hints.elementSizes.begin(), hints.elementSizes.end());
+
+	if (hints.elementFormats.empty()) {
+		elementFormats.assign(hints.elementSizes.size(), FORMAT_FLOAT);
+	}
+	else {
+		elementFormats.assign(hints.elementFormats.begin(),
+				hints.elementFormats.end());
+	}
+
 	elements.resize(hints.elementSizes.size());
 }
 
+IndexedModel::IndexedModel(const IndexedModelView& view)
+		: indices(view.indices, view.indices + view.numIndices)
+		, elementSizes(view.elementSizes, view.elementSizes + view.elements.size())
+		, elementFormats(view.elementFormats, view.elementFormats + view.elements.size())
+		, instancedElementStartIndex(view.instancedElementStartIndex)
+		, flags(view.flags)
+		, aabb(view.aabb)
+		, boundingSphere(view.boundingSphere)
+		, boundsValid(view.boundsValid) {
+	elements.resize(view.elements.size());
+
+	for (uint32 i = 0; i < view.getNumVertexComponents(); ++i) {
+		elements[i].assign(view.elements[i],
+				view.elements[i] + elementSizes[i] * view.numVertices);
+	}
+}
+
+uintptr IndexedModel::getMemoryUsage() const {
+	uintptr size = indices.capacity() * sizeof(uint32);
+
+	for (auto& element : elements) {
+		size += element.capacity() * sizeof(float);
+	}
+
+	return size;
+}
+
+IndexedModelView IndexedModel::getView() const {
+	IndexedModelView view;
+	view.elements = getVertexData();
+	view.elements.resize(elements.size(), nullptr);
+
+	view.elementSizes = elementSizes.data();
+	view.elementFormats = elementFormats.data();
+	view.indices = indices.data();
+
+	view.numVertices = getNumVertices();
+	view.numIndices = getNumIndices();
+	view.instancedElementStartIndex = instancedElementStartIndex;
+	view.flags = flags;
+
+	view.aabb = aabb;
+	view.boundingSphere = boundingSphere;
+	view.boundsValid = boundsValid;
+
+	return view;
+}
+
 bool IndexedModel::intersectsRay(const Vector3f& pos, const Vector3f& dir,
 		Vector3f& intersectPos, Vector3f& normal) const {
-	uint32 i0, i1, i2;
-	uint32 minI0, minI1, minI2;
+	if (hasBVH() || indices.size() >= 3 * BVH_MIN_TRIANGLES) {
+		float t;
+		const uint32 triangle = getBVH()->intersectRay(pos, dir, t);
+
+		if (triangle == (uint32)-1) {
+			return false;
+		}
+
+		intersectPos = pos + dir * t;
+		normal = calcTriangleNormal(triangle);
+
+		return true;
+	}
+
+	// gather triangles into coordinate streams one batch at a time
+	float streamData[9 * TRIANGLE_BATCH_SIZE];
+
+	Intersects::TriangleStreams streams;
+
+	for (uint32 k = 0; k < 3; ++k) {
+		streams.v0[k] = streamData + k * TRIANGLE_BATCH_SIZE;
+		streams.e1[k] = streamData + (3 + k) * TRIANGLE_BATCH_SIZE;
+		streams.e2[k] = streamData + (6 + k) * TRIANGLE_BATCH_SIZE;
+	}
+
+	const uint32 numTriangles = indices.size() / 3;
 
-	float t;
+	uint32 closest = (uint32)-1;
 	float minT = FLT_MAX;
-	bool intersected = false;
-	
-	for (uint32 i = 0; i < indices.size(); i += 3) {
-		i0 = indices[i];
-		i1 = indices[i + 1];
-		i2 = indices[i + 2];
 
-		/*Vector3f v0 = Vector3f(&elements[0][3 * i0]);
-		Vector3f v1 = Vector3f(&elements[0][3 * i1]);
-		Vector3f v2 = Vector3f(&elements[0][3 * i2]);*/
+	for (uint32 first = 0; first < numTriangles; first += TRIANGLE_BATCH_SIZE) {
+		const uint32 batchSize = Math::min(numTriangles - first,
+				(uint32)TRIANGLE_BATCH_SIZE);
 
-		const Vector3f& v0 = *((Vector3f*)&elements[0][3 * i0]);
-		const Vector3f& v1 = *((Vector3f*)&elements[0][3 * i1]);
-		const Vector3f& v2 = *((Vector3f*)&elements[0][3 * i2]);
+		for (uint32 j = 0; j < batchSize; ++j) {
+			const uint32 i = 3 * (first + j);
+
+			const Vector3f& v0 = *((Vector3f*)&elements[0][3 * indices[i]]);
+			const Vector3f& v1 = *((Vector3f*)&elements[0][3 * indices[i + 1]]);
+			const Vector3f& v2 = *((Vector3f*)&elements[0][3 * indices[i + 2]]);
+
+			const Vector3f e1 = v1 - v0;
+			const Vector3f e2 = v2 - v0;
+
+			for (uint32 k = 0; k < 3; ++k) {
+				streamData[k * TRIANGLE_BATCH_SIZE + j] = v0[k];
+				streamData[(3 + k) * TRIANGLE_BATCH_SIZE + j] = e1[k];
+				streamData[(6 + k) * TRIANGLE_BATCH_SIZE + j] = e2[k];
+			}
+		}
+
+		const uint32 hit = Intersects::intersectTriangles(pos, dir, streams,
+				batchSize, minT);
+
+		if (hit != (uint32)-1) {
+			closest = first + hit;
+		}
+	}
+
+	if (closest == (uint32)-1) {
+		return false;
+	}
+
+	intersectPos = pos + dir * minT;
+	normal = calcTriangleNormal(closest);
+
+	return true;
+}
+
+uint32 IndexedModel::intersectRays(const Vector3f* positions,
+		const Vector3f* directions, uint32 numRays,
+		Vector3f* intersectPositions, Vector3f* normals,
+		bool* intersected) const {
+	float ts[TriangleBVH::MAX_RAYS_PER_PACKET];
+	uint32 triangles[TriangleBVH::MAX_RAYS_PER_PACKET];
 
-		if (Intersects::intersectTriangle(pos, dir, v0, v1, v2, t)
-				&& t < minT) {
-			minT = t;
-			intersected = true;
+	// held for the whole query
+	const auto tree = getBVH();
+	uint32 numHits = 0;
 
-			minI0 = i0;
-			minI1 = i1;
-			minI2 = i2;
+	for (uint32 i = 0; i < numRays; i += TriangleBVH::MAX_RAYS_PER_PACKET) {
+		const uint32 packetSize = Math::min(numRays - i,
+				TriangleBVH::MAX_RAYS_PER_PACKET);
+
+		tree->intersectRays(positions + i, directions + i, packetSize,
+				ts, triangles);
+
+		for (uint32 j = 0; j < packetSize; ++j) {
+			intersected[i + j] = triangles[j] != (uint32)-1;
+
+			if (intersected[i + j]) {
+				intersectPositions[i + j] = positions[i + j] + directions[i + j] * ts[j];
+				normals[i + j] = calcTriangleNormal(triangles[j]);
+
+				++numHits;
+			}
 		}
 	}
 
-	if (intersected) {
-		intersectPos = pos + dir * minT;
+	return numHits;
+}
+
+Memory::SharedPointer<TriangleBVH> IndexedModel::getBVH() const {
+	auto current = std::atomic_load_explicit(&bvh, std::memory_order_acquire);
 
-		const Vector3f& n0 = *((Vector3f*)&elements[2][3 * minI0]);
-		const Vector3f& n1 = *((Vector3f*)&elements[2][3 * minI1]);
-		const Vector3f& n2 = *((Vector3f*)&elements[2][3 * minI2]);
+	if (!current) {
+		auto built = Memory::make_shared<TriangleBVH>(elements[0].data(),
+				indices.data(), static_cast<uint32>(indices.size()));
 
-		normal = (n0 + n1 + n2) / 3.f;
+		// threads querying at once may each build one, the first to publish
+		// wins and the others adopt it
+		if (std::atomic_compare_exchange_strong_explicit(&bvh, &current, built,
+				std::memory_order_acq_rel, std::memory_order_acquire)) {
+			current = std::move(built);
+		}
 	}
 
-	return intersected;
+	return current;
 }
 
 float IndexedModel::calcSubmergedVolume(const Vector3f& planePosition,
 		const Vector3f& planeNormal, Vector3f& centroidSum) const {
-	float* ds = new float[getNumVertices()];
+	static thread_local ArrayList<float> scratch;
+
+	if (scratch.size() < getNumVertices()) {
+		scratch.resize(getNumVertices());
+	}
+
+	return calcSubmergedVolume(planePosition, planeNormal, centroidSum,
+			scratch.data());
+}
 
+float IndexedModel::calcSubmergedVolume(const Vector3f& planePosition,
+		const Vector3f& planeNormal, Vector3f& centroidSum,
+		float* scratch) const {
 	uint32 numSubmerged = 0;
 	uint32 sampleVert = 0;
 
-	for (uint32 i = 0; i < getNumVertices(); ++i) {
-		const Vector3f& vert = *((Vector3f*)&elements[0][3 * i]);
+	calcPlaneDistances(&planePosition, &planeNormal, 1, scratch, &numSubmerged,
+			&sampleVert);
+
+	return clipSubmergedVolume(planeNormal, scratch, numSubmerged, sampleVert,
+			centroidSum);
+}
+
+void IndexedModel::calcSubmergedVolumes(const Vector3f* planePositions,
+		const Vector3f* planeNormals, uint32 numBodies, float* volumes,
+		Vector3f* centroids) const {
+	static thread_local ArrayList<float> scratch;
+
+	const uint32 numVertices = getNumVertices();
 
-		ds[i] = Math::dot(planeNormal, vert - planePosition);
+	if (scratch.size() < PLANE_BATCH_SIZE * numVertices) {
+		scratch.resize(PLANE_BATCH_SIZE * numVertices);
+	}
+
+	uint32 numSubmerged[PLANE_BATCH_SIZE];
+	uint32 sampleVerts[PLANE_BATCH_SIZE];
+
+	for (uint32 first = 0; first < numBodies; first += PLANE_BATCH_SIZE) {
+		const uint32 batchSize = Math::min(numBodies - first,
+				(uint32)PLANE_BATCH_SIZE);
+
+		calcPlaneDistances(planePositions + first, planeNormals + first,
+				batchSize, scratch.data(), numSubmerged, sampleVerts);
+
+		for (uint32 j = 0; j < batchSize; ++j) {
+			const uint32 i = first + j;
 
-		if (ds[i] < -EPSILON) {
-			++numSubmerged;
-			sampleVert = i;
+			volumes[i] = clipSubmergedVolume(planeNormals[i],
+					scratch.data() + j * numVertices, numSubmerged[j],
+					sampleVerts[j], centroids[i]);
+
+			if (volumes[i] > 0) {
+				centroids[i] /= volumes[i];
+			}
 		}
 	}
+}
 
-	if (numSubmerged == 0) {
-		centroidSum = Vector3f(0.f, 0.f, 0.f);
-		delete[] ds;
+float IndexedModel::clipSubmergedVolume(const Vector3f& planeNormal,
+		const float* ds, uint32 numSubmerged, uint32 sampleVert,
+		Vector3f& centroidSum) const {
+	centroidSum = Vector3f(0.f, 0.f, 0.f);
 
+	if (numSubmerged == 0) {
 		return 0;
 	}
 
@@ -95,21 +282,24 @@ float IndexedModel::calcSubmergedVolume(const Vector3f& planePosition,
 			- ds[sampleVert] * planeNormal;
 
 	float volume = 0;
-	centroidSum = Vector3f(0.f, 0.f, 0.f);
 
 	for (uint32 i = 0; i < indices.size(); i += 3) {
 		uint32 i1 = indices[i];
 		uint32 i2 = indices[i + 1];
 		uint32 i3 = indices[i + 2];
 
-		const Vector3f& v1 = *((Vector3f*)&elements[0][3 * i1]);
 		float d1 = ds[i1];
-
-		const Vector3f& v2 = *((Vector3f*)&elements[0][3 * i2]);
 		float d2 = ds[i2];
+		float d3 = ds[i3];
 
+		// fully emerged triangles contribute nothing
+		if (d1 >= 0 && d2 >= 0 && d3 >= 0) {
+			continue;
+		}
+
+		const Vector3f& v1 = *((Vector3f*)&elements[0][3 * i1]);
+		const Vector3f& v2 = *((Vector3f*)&elements[0][3 * i2]);
 		const Vector3f& v3 = *((Vector3f*)&elements[0][3 * i3]);
-		float d3 = ds[i3];
 
 		if (d1 * d2 < 0) {
 			volume += clipTriangle(centroidSum, p, v1, v2, v3, d1, d2, d3);
@@ -120,21 +310,18 @@ float IndexedModel::calcSubmergedVolume(const Vector3f& planePosition,
 		else if (d2 * d3 < 0) {
 			volume += clipTriangle(centroidSum, p, v2, v3, v1, d2, d3, d1);
 		}
-		else if (d1 < 0 || d2 < 0 || d3 < 0) {
+		else {
 			volume += tetrahedronVolume(centroidSum, p, v1, v2, v3);
 		}
 	}
 
 	if (volume <= EPSILON) {
 		centroidSum = Vector3f(0.f, 0.f, 0.f);
-		delete[] ds;
-
 		return 0;
 	}
 
 	//centroidSum /= volume;
 
-	delete[] ds;
 	return volume;
 }
 
@@ -149,30 +336,141 @@ void IndexedModel::initStaticMesh() {
 	setInstancedElementStartIndex(5); // Begin instanced data
 }
 
-void IndexedModel::initRiggedMesh() {
+void IndexedModel::initRiggedMesh(bool wideJointIndices) {
 	allocateElement(3); // Positions
 	allocateElement(2); // TexCoords
 	allocateElement(3); // Normals
 	allocateElement(3); // Tangents
 	allocateElement(3); // Bitangents
-	allocateElement(3); // Bone Indices
-	allocateElement(3); // Bone Weights
+
+	if (wideJointIndices) {
+		allocateElement(2, FORMAT_USHORT4); // Bone Indices
+	}
+	else {
+		allocateElement(1, FORMAT_UBYTE4); // Bone Indices
+	}
+
+	allocateElement(1, FORMAT_UBYTE4_NORM); // Bone Weights
 	allocateElement(16); // Transform
 
 	setInstancedElementStartIndex(7); // Begin instanced data
 }
 
+void IndexedModel::calcBounds() {
+	// element 0 is always the tightly packed vertex positions
+	aabb = AABB(elements[0].data(), getNumVertices());
+	boundingSphere = Sphere(elements[0].data(), getNumVertices());
+
+	boundsValid = true;
+}
+
+Vector3f IndexedModel::calcTriangleNormal(uint32 triangle) const {
+	const Vector3f& n0 = *((Vector3f*)&elements[2][3 * indices[3 * triangle]]);
+	const Vector3f& n1 = *((Vector3f*)&elements[2][3 * indices[3 * triangle + 1]]);
+	const Vector3f& n2 = *((Vector3f*)&elements[2][3 * indices[3 * triangle + 2]]);
+
+	return (n0 + n1 + n2) / 3.f;
+}
+
+void IndexedModel::calcPlaneDistances(const Vector3f* planePositions,
+		const Vector3f* planeNormals, uint32 numPlanes, float* ds,
+		uint32* numSubmerged, uint32* sampleVerts) const {
+	const uint32 numVertices = getNumVertices();
+	const float* positions = elements[0].data();
+
+	// 4 tightly packed positions are 3 registers: xyzx yzxy zxyz
+	__m128 n[PLANE_BATCH_SIZE][3];
+	__m128 p[PLANE_BATCH_SIZE][3];
+
+	for (uint32 k = 0; k < numPlanes; ++k) {
+		const Vector3f& normal = planeNormals[k];
+		const Vector3f& position = planePositions[k];
+
+		n[k][0] = _mm_setr_ps(normal.x, normal.y, normal.z, normal.x);
+		n[k][1] = _mm_setr_ps(normal.y, normal.z, normal.x, normal.y);
+		n[k][2] = _mm_setr_ps(normal.z, normal.x, normal.y, normal.z);
+		p[k][0] = _mm_setr_ps(position.x, position.y, position.z, position.x);
+		p[k][1] = _mm_setr_ps(position.y, position.z, position.x, position.y);
+		p[k][2] = _mm_setr_ps(position.z, position.x, position.y, position.z);
+
+		numSubmerged[k] = 0;
+		sampleVerts[k] = 0;
+	}
+
+	const __m128 epsilon = _mm_set1_ps(-EPSILON);
+	uint32 i = 0;
+
+	// every plane is measured while the vertices are in registers
+	for (; i + 4 <= numVertices; i += 4) {
+		const __m128 v0 = _mm_loadu_ps(positions + 3 * i);
+		const __m128 v1 = _mm_loadu_ps(positions + 3 * i + 4);
+		const __m128 v2 = _mm_loadu_ps(positions + 3 * i + 8);
+
+		for (uint32 k = 0; k < numPlanes; ++k) {
+			const __m128 m0 = _mm_mul_ps(n[k][0], _mm_sub_ps(v0, p[k][0]));
+			const __m128 m1 = _mm_mul_ps(n[k][1], _mm_sub_ps(v1, p[k][1]));
+			const __m128 m2 = _mm_mul_ps(n[k][2], _mm_sub_ps(v2, p[k][2]));
+
+			// regroup the products into x, y and z terms of each vertex
+			const __m128 x = _mm_shuffle_ps(m0, _mm_shuffle_ps(m1, m2,
+					_MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+			const __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 0, 1, 1)),
+					_mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 1, 2, 2)),
+					_mm_shuffle_ps(m2, m2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+			const __m128 d = _mm_add_ps(_mm_add_ps(x, y), z);
+			_mm_storeu_ps(ds + k * numVertices + i, d);
+
+			const int32 submergedMask = _mm_movemask_ps(_mm_cmplt_ps(d, epsilon));
+
+			for (uint32 j = 0; j < 4; ++j) {
+				if (submergedMask & (1 << j)) {
+					++numSubmerged[k];
+					sampleVerts[k] = i + j;
+				}
+			}
+		}
+	}
+
+	for (; i < numVertices; ++i) {
+		const Vector3f& vert = *((Vector3f*)&positions[3 * i]);
+
+		for (uint32 k = 0; k < numPlanes; ++k) {
+			float& d = ds[k * numVertices + i];
+			d = Math::dot(planeNormals[k], vert - planePositions[k]);
+
+			if (d < -EPSILON) {
+				++numSubmerged[k];
+				sampleVerts[k] = i;
+			}
+		}
+	}
+}
+
 void IndexedModel::addElement1f(uint32 elementIndex, float e0) {
+	if (elementIndex == 0) {
+		invalidateGeometry();
+	}
+
 	elements[elementIndex].push_back(e0);
 }
 
 void IndexedModel::addElement2f(uint32 elementIndex, float e0, float e1) {
+	if (elementIndex == 0) {
+		invalidateGeometry();
+	}
+
 	elements[elementIndex].push_back(e0);
 	elements[elementIndex].push_back(e1);
 }
 
 void IndexedModel::addElement3f(uint32 elementIndex, float e0, float e1,
 		float e2) {
+	if (elementIndex == 0) {
+		invalidateGeometry();
+	}
+
 	elements[elementIndex].push_back(e0);
 	elements[elementIndex].push_back(e1);
 	elements[elementIndex].push_back(e2);
@@ -180,14 +478,33 @@ void IndexedModel::addElement3f(uint32 elementIndex, float e0, float e1,
 
 void IndexedModel::addElement4f(uint32 elementIndex, float e0, float e1,
 		float e2, float e3) {
+	if (elementIndex == 0) {
+		invalidateGeometry();
+	}
+
 	elements[elementIndex].push_back(e0);
 	elements[elementIndex].push_back(e1);
 	elements[elementIndex].push_back(e2);
 	elements[elementIndex].push_back(e3);
 }
 
+void IndexedModel::addElementWord(uint32 elementIndex, uint32 word) {
+	if (elementIndex == 0) {
+		invalidateGeometry();
+	}
+
+	float e0;
+	Memory::memcpy(&e0, &word, sizeof(float));
+
+	elements[elementIndex].push_back(e0);
+}
+
 void IndexedModel::setElement4f(uint32 elementIndex, uint32 arrayIndex,
 		float e0, float e1, float e2, float e3) {
+	if (elementIndex == 0) {
+		invalidateGeometry();
+	}
+
 	arrayIndex *= elementSizes[elementIndex];
 
 	elements[elementIndex][arrayIndex] = e0;
@@ -197,21 +514,29 @@ void IndexedModel::setElement4f(uint32 elementIndex, uint32 arrayIndex,
 }
 
 void IndexedModel::addIndices1i(uint32 i0) {
+	invalidateGeometry();
+
 	indices.push_back(i0);
 }
 
 void IndexedModel::addIndices2i(uint32 i0, uint32 i1) {
+	invalidateGeometry();
+
 	indices.push_back(i0);
 	indices.push_back(i1);
 }
 
 void IndexedModel::addIndices3i(uint32 i0, uint32 i1, uint32 i2) {
+	invalidateGeometry();
+
 	indices.push_back(i0);
 	indices.push_back(i1);
 	indices.push_back(i2);
 }
 
 void IndexedModel::addIndices4i(uint32 i0, uint32 i1, uint32 i2, uint32 i3) {
+	invalidateGeometry();
+
 	indices.push_back(i0);
 	indices.push_back(i1);
 	indices.push_back(i2);
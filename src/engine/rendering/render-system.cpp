@@ -3,10 +3,13 @@
 #include <engine/animation/rig.hpp>
 
 #include <engine/rendering/vertex-array.hpp>
+#include <engine/rendering/shader-storage-buffer.hpp>
 #include <engine/rendering/material.hpp>
 #include <engine/rendering/gaussian-blur.hpp>
 #include <engine/rendering/font.hpp>
 
+#define JOINT_PALETTE_BINDING 4
+
 static void initSkyboxCube(IndexedModel&);
 static void initScreenQuad(IndexedModel&);
 static void initUIQuad(IndexedModel&);
@@ -27,6 +30,7 @@ RenderSystem::RenderSystem(RenderContext& context, uint32 width, uint32 height,
 
 		, staticMeshShader(context)
 		, riggedMeshShader(context)
+		, riggedMeshInstancedShader(context)
 
 		, skyboxShader(context)
 		, lightingShader(context)
@@ -43,6 +47,9 @@ RenderSystem::RenderSystem(RenderContext& context, uint32 width, uint32 height,
 		, linearMipmapSampler(context,
 				GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR)
 		
+		, jointPaletteBuffer(nullptr)
+		, jointPaletteBufferSize(0)
+
 		, diffuseIBL(nullptr)
 		, specularIBL(nullptr)
 		, brdfLUT(nullptr)
@@ -51,7 +58,13 @@ RenderSystem::RenderSystem(RenderContext& context, uint32 width, uint32 height,
 		, zNear(zNear)
 		, zFar(zFar)
 		, camera({Matrix4f(1.f), Matrix4f(1.f), Matrix4f(1.f),
-				Matrix4f(1.f), Matrix4f(1.f)}) {
+				Matrix4f(1.f), Matrix4f(1.f)})
+		, jointPaletteFormat(JointPaletteFormat::MATRIX4X4)
+		, riggedMeshInstancing(false)
+		, riggedMeshInstancedShaderLoaded(false)
+		, paletteOverflowReported(false)
+		, numFlushedFrames(0)
+		, numSteadyAllocations(0) {
 	drawParams.faceCullMode = DrawParams::FACE_CULL_BACK;
 	drawParams.depthFunc = DrawParams::DRAW_FUNC_LEQUAL;
 	drawParams.writeDepth = true;
@@ -144,6 +157,9 @@ void RenderSystem::resize(uint32 width, uint32 height) {
 void RenderSystem::updateCamera() {
 	camera.update();
 
+	frustumCuller.setFrustum(camera.viewProjection);
+	frustumCuller.resetStats();
+
 	auto sceneDataBuffer = context->getUniformBuffer("SceneData").lock();
 
 	sceneDataBuffer->set({"cameraPosition", "viewProjection", "invVP"},
@@ -152,12 +168,20 @@ void RenderSystem::updateCamera() {
 
 void RenderSystem::drawStaticMesh(VertexArray& vertexArray,
 		Material& material, const Matrix4f& transform) {
-	staticMeshes[std::make_pair(&vertexArray, &material)].push_back(transform);
+	staticMeshQueue.add(DrawCommandBuffer::makeSortKey(target.getID(),
+			staticMeshShader.getID(), material.getID(), vertexArray.getID(),
+			calcSortDepth(transform)), staticMeshes.size());
+
+	staticMeshes.push_back({&vertexArray, &material, transform});
 }
 
 void RenderSystem::drawRiggedMesh(VertexArray& vertexArray,
 		Material& material, Rig& rig, const Matrix4f& transform) {
-	riggedMeshes[std::make_pair(&vertexArray, &material)].push_back(std::make_pair(&rig, transform));
+	riggedMeshQueue.add(DrawCommandBuffer::makeSortKey(target.getID(),
+			riggedMeshShader.getID(), material.getID(), vertexArray.getID(),
+			calcSortDepth(transform)), riggedMeshes.size());
+
+	riggedMeshes.push_back({&vertexArray, &material, &rig, transform});
 }
 
 void RenderSystem::drawTextureQuad(Texture& texture, const Vector4f& positions,
@@ -204,6 +228,7 @@ RenderSystem::~RenderSystem() {
 	delete screenQuad;
 	delete uiQuad;
 	delete bloomBlur;
+	delete jointPaletteBuffer;
 }
 
 void RenderSystem::clear() {
@@ -244,88 +269,209 @@ void RenderSystem::flushStaticMeshes() {
 	Material* material;
 
 	VertexArray* vertexArray;
-	uintptr numTransforms;
 
-	for (auto& pair : staticMeshes) {
-		numTransforms = pair.second.size();
+	staticMeshQueue.sort();
 
-		if (numTransforms == 0) {
-			continue;
-		}
+	const auto* commands = staticMeshQueue.data();
+	const size_t numCommands = staticMeshQueue.size();
 
-		vertexArray = pair.first.first;
-		material = pair.first.second;
+	for (size_t i = 0; i < numCommands;) {
+		vertexArray = staticMeshes[commands[i].index].vertexArray;
+		material = staticMeshes[commands[i].index].material;
 
-		if (material != currentMaterial) {
-			currentMaterial = material;
+		instanceTransforms.clear();
+
+		for (; i < numCommands; ++i) {
+			const auto& smc = staticMeshes[commands[i].index];
+
+			if (smc.vertexArray != vertexArray || smc.material != material) {
+				break;
+			}
 
-			staticMeshShader.setSampler("diffuse", *material->diffuse,
-					linearMipmapSampler, 0);
-			staticMeshShader.setSampler("normalMap", *material->normalMap,
-					linearMipmapSampler, 1);
-			staticMeshShader.setSampler("materialMap",
-					*material->materialMap, linearMipmapSampler, 2);
-			staticMeshShader.setSampler("depthMap", *material->displacementMap,
-					linearMipmapSampler, 3);
+			instanceTransforms.push_back(smc.transform);
+		}
 
-			staticMeshShader.setFloat("heightScale", material->displacementScale);
+		if (material != currentMaterial) {
+			currentMaterial = material;
+			setMaterial(staticMeshShader, *material);
 		}
 
-		vertexArray->updateBuffer(5, &pair.second[0],
-				sizeof(Matrix4f) * numTransforms);
+		vertexArray->updateBuffer(5, instanceTransforms.data(),
+				sizeof(Matrix4f) * instanceTransforms.size());
 
 		context->draw(target, staticMeshShader, *vertexArray,
-				drawParams, GL_TRIANGLES, numTransforms);
+				drawParams, GL_TRIANGLES, instanceTransforms.size());
 	}
 
-	staticMeshes.clear();
+	staticMeshQueue.endFrame();
+	staticMeshes.endFrame();
 }
 
 void RenderSystem::flushRiggedMeshes() {
+	if (riggedMeshInstancing) {
+		flushRiggedMeshesInstanced();
+		return;
+	}
+
 	Material* currentMaterial = nullptr;
 	Material* material;
 
-	VertexArray* vertexArray;
+	auto animBuf = context->getUniformBuffer("AnimationData").lock();
 
-	uintptr numTransforms;
+	const uint32 stride = JointPalette::getStride(jointPaletteFormat);
 
-	auto animBuf = context->getUniformBuffer("AnimationData").lock();
+	riggedMeshShader.setInt("paletteFormat", static_cast<int32>(jointPaletteFormat));
+
+	riggedMeshQueue.sort();
+
+	const auto* commands = riggedMeshQueue.data();
+	const size_t numCommands = riggedMeshQueue.size();
+
+	for (size_t i = 0; i < numCommands; ++i) {
+		auto& rmc = riggedMeshes[commands[i].index];
+
+		const uint32 numJoints = rmc.rig->getNumBones();
+		const uintptr paletteSize = static_cast<uintptr>(numJoints) * stride
+				* sizeof(Vector4f);
 
-	for (auto& pair : riggedMeshes) {
-		numTransforms = pair.second.size();
+		// rigs larger than the uniform block need the instanced path and its
+		// storage buffer, drawing them with a truncated palette skins garbage
+		if (paletteSize > animBuf->getSize()) {
+			if (!paletteOverflowReported) {
+				DEBUG_LOG(LOG_ERROR, "Render System",
+						"Rig with %u joints needs %u bytes of AnimationData, "
+						"the block holds %u, enable rigged mesh instancing to draw it",
+						numJoints, static_cast<uint32>(paletteSize),
+						static_cast<uint32>(animBuf->getSize()));
+
+				paletteOverflowReported = true;
+			}
 
-		if (numTransforms == 0) {
 			continue;
 		}
 
-		vertexArray = pair.first.first;
-		material = pair.first.second;
+		material = rmc.material;
 
 		if (material != currentMaterial) {
 			currentMaterial = material;
+			setMaterial(riggedMeshShader, *material);
+		}
 
-			riggedMeshShader.setSampler("diffuse", *material->diffuse,
-					linearMipmapSampler, 0);
-			riggedMeshShader.setSampler("normalMap", *material->normalMap,
-					linearMipmapSampler, 1);
-			riggedMeshShader.setSampler("materialMap",
-					*material->materialMap, linearMipmapSampler, 2);
-			riggedMeshShader.setSampler("depthMap", *material->displacementMap,
-					linearMipmapSampler, 3);
+		jointPalettes.resize(numJoints * stride);
+		JointPalette::pack(jointPaletteFormat, rmc.rig->getTransformSet(),
+				numJoints, jointPalettes.data());
 
-			riggedMeshShader.setFloat("heightScale", material->displacementScale);
-		}
+		// only the joints the rig uses are uploaded
+		animBuf->update(jointPalettes.data(), paletteSize);
+
+		rmc.vertexArray->updateBuffer(7, &rmc.transform, sizeof(Matrix4f));
+		context->draw(target, riggedMeshShader, *rmc.vertexArray,
+				drawParams, GL_TRIANGLES);
+	}
+
+	riggedMeshQueue.endFrame();
+	riggedMeshes.endFrame();
+	jointPalettes.endFrame();
+}
+
+void RenderSystem::flushRiggedMeshesInstanced() {
+	Material* currentMaterial = nullptr;
+	Material* material;
+
+	VertexArray* vertexArray;
+
+	riggedMeshQueue.sort();
+
+	const auto* commands = riggedMeshQueue.data();
+	const size_t numCommands = riggedMeshQueue.size();
+
+	if (numCommands == 0) {
+		riggedMeshQueue.endFrame();
+		riggedMeshes.endFrame();
+		jointPalettes.endFrame();
+
+		return;
+	}
+
+	// palettes are laid out in sorted order so each batch reads a contiguous
+	// range, every rig only takes as many matrices as it has bones
+	size_t numJoints = 0;
+
+	for (size_t i = 0; i < numCommands; ++i) {
+		numJoints += riggedMeshes[commands[i].index].rig->getNumBones();
+	}
+
+	const uint32 stride = JointPalette::getStride(jointPaletteFormat);
+
+	jointPalettes.resize(numJoints * stride);
 
-		for (auto& rigTF : pair.second) {
-			animBuf->update(rigTF.first->getTransformSet(), Rig::MAX_JOINTS * sizeof(Matrix4f));
+	for (size_t i = 0, offset = 0; i < numCommands; ++i) {
+		const Rig& rig = *riggedMeshes[commands[i].index].rig;
 
-			vertexArray->updateBuffer(7, &rigTF.second, sizeof(Matrix4f));
-			context->draw(target, riggedMeshShader, *vertexArray,
-					drawParams, GL_TRIANGLES);
+		JointPalette::pack(jointPaletteFormat, rig.getTransformSet(),
+				rig.getNumBones(), &jointPalettes[offset]);
+		offset += rig.getNumBones() * stride;
+	}
+
+	const uintptr paletteSize = jointPalettes.size() * sizeof(Vector4f);
+
+	if (paletteSize > jointPaletteBufferSize) {
+		jointPaletteBufferSize = Math::max(paletteSize, 2 * jointPaletteBufferSize);
+
+		delete jointPaletteBuffer;
+		jointPaletteBuffer = new ShaderStorageBuffer(*context, jointPaletteBufferSize,
+				GL_DYNAMIC_DRAW, JOINT_PALETTE_BINDING);
+	}
+
+	if (paletteSize > 0) {
+		jointPaletteBuffer->update(jointPalettes.data(), paletteSize);
+	}
+
+	riggedMeshInstancedShader.setInt("paletteFormat",
+			static_cast<int32>(jointPaletteFormat));
+
+	for (size_t i = 0, paletteOffset = 0; i < numCommands;) {
+		vertexArray = riggedMeshes[commands[i].index].vertexArray;
+		material = riggedMeshes[commands[i].index].material;
+
+		// instances of a batch index their palette with a fixed stride
+		const size_t jointsPerInstance = riggedMeshes[commands[i].index]
+				.rig->getNumBones();
+
+		instanceTransforms.clear();
+
+		for (; i < numCommands; ++i) {
+			const auto& rmc = riggedMeshes[commands[i].index];
+
+			if (rmc.vertexArray != vertexArray || rmc.material != material
+					|| rmc.rig->getNumBones() != jointsPerInstance) {
+				break;
+			}
+
+			instanceTransforms.push_back(rmc.transform);
+		}
+
+		if (material != currentMaterial) {
+			currentMaterial = material;
+			setMaterial(riggedMeshInstancedShader, *material);
 		}
+
+		// counted in joints, the shader scales them by the format's stride
+		riggedMeshInstancedShader.setInt("jointsPerInstance", jointsPerInstance);
+		riggedMeshInstancedShader.setInt("paletteOffset", paletteOffset);
+
+		paletteOffset += jointsPerInstance * instanceTransforms.size();
+
+		vertexArray->updateBuffer(7, instanceTransforms.data(),
+				sizeof(Matrix4f) * instanceTransforms.size());
+
+		context->draw(target, riggedMeshInstancedShader, *vertexArray,
+				drawParams, GL_TRIANGLES, instanceTransforms.size());
 	}
 
-	riggedMeshes.clear();
+	riggedMeshQueue.endFrame();
+	riggedMeshes.endFrame();
+	jointPalettes.endFrame();
 }
 
 void RenderSystem::flush() {
@@ -353,6 +499,12 @@ void RenderSystem::flush() {
 	drawParams.writeDepth = true;
 	// TODO: Take note that this causes rendering issues when not present
 	// assumingly because its setting the write depth while the screen framebuffer is set
+
+	// shared by the static and the instanced rigged mesh flush, so its frame
+	// ends once here instead
+	instanceTransforms.endFrame();
+
+	checkSubmissionAllocations();
 }
 
 void RenderSystem::flushTexturedQuads() {
@@ -378,12 +530,72 @@ void RenderSystem::flushTexturedQuads() {
 
 		pair.second.positionPairs.clear();
 		pair.second.scalePairs.clear();
+		pair.second.colors.clear();
 	}
 
 	drawParams.sourceBlend = DrawParams::BLEND_FUNC_NONE;
 	drawParams.destBlend = DrawParams::BLEND_FUNC_NONE;
 }
 
+bool RenderSystem::setRiggedMeshInstancing(bool enabled) {
+	// a failed compile or link still leaves a program object behind, so the
+	// load result decides whether the shader is usable and failures retry
+	if (enabled && !riggedMeshInstancedShaderLoaded) {
+		riggedMeshInstancedShaderLoaded = riggedMeshInstancedShader.load(
+				"./res/shaders/rigged-mesh-instanced-deferred.glsl");
+
+		if (!riggedMeshInstancedShaderLoaded) {
+			DEBUG_LOG("Render System", LOG_WARNING,
+					"Instanced rigged mesh shader unavailable, using per-instance draws");
+
+			return false;
+		}
+	}
+
+	riggedMeshInstancing = enabled;
+
+	return true;
+}
+
+uint32 RenderSystem::getNumSubmissionAllocations() const {
+	return staticMeshQueue.getNumAllocations() + staticMeshes.getNumAllocations()
+			+ riggedMeshQueue.getNumAllocations() + riggedMeshes.getNumAllocations()
+			+ instanceTransforms.getNumAllocations() + jointPalettes.getNumAllocations();
+}
+
+void RenderSystem::checkSubmissionAllocations() {
+	const uint32 numAllocations = getNumSubmissionAllocations();
+
+	if (numFlushedFrames < SUBMISSION_WARMUP_FRAMES) {
+		++numFlushedFrames;
+	}
+	else if (numAllocations > numSteadyAllocations) {
+		DEBUG_LOG(LOG_WARNING, "Render System",
+				"Submission buffers allocated %u times after warm-up",
+				numAllocations - numSteadyAllocations);
+	}
+
+	numSteadyAllocations = numAllocations;
+}
+
+float RenderSystem::calcSortDepth(const Matrix4f& transform) const {
+	// w of the clip space position is the view space depth for a perspective projection
+	const float depth = (camera.viewProjection * transform[3]).w;
+
+	return (depth - zNear) / (zFar - zNear);
+}
+
+void RenderSystem::setMaterial(Shader& shader, Material& material) {
+	shader.setSampler("diffuse", *material.diffuse, linearMipmapSampler, 0);
+	shader.setSampler("normalMap", *material.normalMap, linearMipmapSampler, 1);
+	shader.setSampler("materialMap", *material.materialMap,
+			linearMipmapSampler, 2);
+	shader.setSampler("depthMap", *material.displacementMap,
+			linearMipmapSampler, 3);
+
+	shader.setFloat("heightScale", material.displacementScale);
+}
+
 void RenderSystem::drawScreenQuad(RenderTarget& target, Shader& shader, uint32 numInstances) {
 	context->draw(target, shader, *screenQuad, drawParams, GL_TRIANGLES, numInstances);
 }
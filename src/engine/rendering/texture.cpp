@@ -130,6 +130,21 @@ void Texture::setImage(const Bitmap& bitmap) {
 	setImage(bitmap.getWidth(), bitmap.getHeight(), bitmap.getPixels());
 }
 
+uintptr Texture::getMemoryUsage() const {
+	uintptr size;
+
+	if (compressed) {
+		const uintptr blockSize = (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+		size = static_cast<uintptr>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	}
+	else {
+		size = static_cast<uintptr>(width) * height * 4;
+	}
+
+	// a full mip chain adds a third
+	return mipMaps ? size + size / 3 : size;
+}
+
 Texture::~Texture() {
 	glDeleteTextures(1, &textureID);
 }
@@ -4,12 +4,15 @@
 
 VertexArray::VertexArray(RenderContext& context,
 			const IndexedModel& model, uint32 usage)
+		: VertexArray(context, model.getView(), usage) {}
+
+VertexArray::VertexArray(RenderContext& context,
+			const IndexedModelView& model, uint32 usage)
 		: context(&context)
 		, arrayID(0)
-		, numBuffers(model.getNumVertexComponents()
-				+ model.getNumInstanceComponents() + 1)
-		, numElements(model.getNumIndices())
-		, instancedComponentStartIndex(model.getInstancedElementStartIndex())
+		, numBuffers(model.elements.size() + 1)
+		, numElements(model.numIndices)
+		, instancedComponentStartIndex(model.instancedElementStartIndex)
 		, numOwnedBuffers(numBuffers)
 		, buffers(new GLuint[numBuffers])
 		, bufferSizes(new uintptr[numBuffers])
@@ -19,26 +22,27 @@ VertexArray::VertexArray(RenderContext& context,
 	glGenVertexArrays(1, &arrayID);
 	context.setVertexArray(arrayID);
 
-	glGenBuffers(numBuffers, buffers);
+	if (model.boundsValid) {
+		setBounds(model.aabb, model.boundingSphere);
+	}
 
-	ArrayList<const float*> vertexData = model.getVertexData();
+	glGenBuffers(numBuffers, buffers);
 
-	if (model.getFlags() & IndexedModel::FLAG_INTERLEAVED_INSTANCES) {
+	if (model.flags & IndexedModel::FLAG_INTERLEAVED_INSTANCES) {
 		initMultiVertexSingleInstance(model.getNumVertexComponents(), 
-				&vertexData[0], model.getNumVertices(),
-				model.getElementSizes(), true);
+				model.elements.data(), model.numVertices,
+				model.elementSizes, model.elementFormats, true);
 	}
 	else {
 		initMultiVertexMultiInstance(model.getNumVertexComponents(),
-				&vertexData[0], model.getNumVertices(),
-				model.getElementSizes(), true);
+				model.elements.data(), model.numVertices,
+				model.elementSizes, model.elementFormats, true);
 	}
 
 	uintptr indicesSize = numElements * sizeof(uint32);
 	
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[numBuffers - 1]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize,
-			model.getIndices(), usage);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize, model.indices, usage);
 
 	bufferSizes[numBuffers - 1] = indicesSize;
 }
@@ -59,6 +63,10 @@ VertexArray::VertexArray(RenderContext& context,
 	glGenVertexArrays(1, &arrayID);
 	context.setVertexArray(arrayID);
 
+	if (model.hasBounds()) {
+		setBounds(model.getAABB(), model.getBoundingSphere());
+	}
+
 	Memory::memcpy(buffers, vertexArray.buffers, numBuffers * sizeof(GLuint));
 
 	glGenBuffers(numOwnedBuffers, buffers + instancedComponentStartIndex);
@@ -66,7 +74,7 @@ VertexArray::VertexArray(RenderContext& context,
 	ArrayList<const float*> vertexData = model.getVertexData();
 	initMultiVertexMultiInstance(model.getNumVertexComponents(),
 			&vertexData[0], model.getNumVertices(), model.getElementSizes(),
-			false);
+			model.getElementFormats(), false);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[numBuffers - 1]);
 	
@@ -111,6 +119,10 @@ VertexArray::VertexArray(RenderContext& context,
 	glGenVertexArrays(1, &arrayID);
 	context.setVertexArray(arrayID);
 
+	if (model.hasBounds()) {
+		setBounds(model.getAABB(), model.getBoundingSphere());
+	}
+
 	glGenBuffers(model.getNumVertexComponents(), buffers);
 	glGenBuffers(1, &buffers[numBuffers - 1]);
 
@@ -119,7 +131,7 @@ VertexArray::VertexArray(RenderContext& context,
 	ArrayList<const float*> vertexData = model.getVertexData();
 	initSharedBuffers(model.getNumVertexComponents(), &vertexData[0],
 			model.getNumVertices(), model.getElementSizes(),
-			tfb.getNumAttribs(), tfb.getAttribSizes(),
+			model.getElementFormats(), tfb.getNumAttribs(), tfb.getAttribSizes(),
 			tfb.getDataBlockSize(), tfb.getBufferSize(), true);
 
 	uintptr indicesSize = numElements * sizeof(uint32);
@@ -148,6 +160,10 @@ VertexArray::VertexArray(RenderContext& context,
 	glGenVertexArrays(1, &arrayID);
 	context.setVertexArray(arrayID);
 
+	if (model.hasBounds()) {
+		setBounds(model.getAABB(), model.getBoundingSphere());
+	}
+
 	Memory::memcpy(buffers, vertexArray.buffers,
 			model.getNumVertexComponents() * sizeof(GLuint));
 
@@ -157,7 +173,7 @@ VertexArray::VertexArray(RenderContext& context,
 	ArrayList<const float*> vertexData = model.getVertexData();
 	initSharedBuffers(model.getNumVertexComponents(), &vertexData[0],
 			model.getNumVertices(), model.getElementSizes(),
-			tfb.getNumAttribs(), tfb.getAttribSizes(),
+			model.getElementFormats(), tfb.getNumAttribs(), tfb.getAttribSizes(),
 			tfb.getDataBlockSize(), tfb.getBufferSize(), false);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[numBuffers - 1]);
@@ -227,8 +243,9 @@ VertexArray::~VertexArray() {
 }
 
 void VertexArray::initMultiVertexMultiInstance(uint32 numVertexComponents,
-		const float** vertexData, uint32 numVertices,
-		const uint32* vertexElementSizes, bool writeData) {
+		const float* const* vertexData, uint32 numVertices,
+		const uint32* vertexElementSizes, const uint32* vertexElementFormats,
+		bool writeData) {
 	for (uint32 i = 0, attribute = 0; i < numBuffers - 1; ++i) {
 		uint32 attribUsage = usage;
 		bool instancedMode = false;
@@ -251,13 +268,15 @@ void VertexArray::initMultiVertexMultiInstance(uint32 numVertexComponents,
 		
 		bufferSizes[i] = dataSize;
 
-		initDistributedAttribute(elementSize, instancedMode, attribute);
+		initDistributedAttribute(elementSize, vertexElementFormats[i],
+				instancedMode, attribute);
 	}
 }
 
 void VertexArray::initMultiVertexSingleInstance(uint32 numVertexComponents,
-		const float** vertexData, uint32 numVertices,
-		const uint32* vertexElementSizes, bool writeData) {
+		const float* const* vertexData, uint32 numVertices,
+		const uint32* vertexElementSizes, const uint32* vertexElementFormats,
+		bool writeData) {
 	uint32 attribute = 0;
 
 	for (uint32 i = 0; i < numVertexComponents; ++i) {
@@ -272,7 +291,8 @@ void VertexArray::initMultiVertexSingleInstance(uint32 numVertexComponents,
 		
 		bufferSizes[i] = dataSize;
 
-		initDistributedAttribute(elementSize, false, attribute);
+		initDistributedAttribute(elementSize, vertexElementFormats[i], false,
+				attribute);
 	}
 
 	uint32 instancedDataSize = 0;
@@ -311,13 +331,15 @@ void VertexArray::initEmptyArrayBuffers(uint32 numVertexComponents,
 
 		bufferSizes[i] = dataSize;
 
-		initDistributedAttribute(elementSize, instancedMode, attribute);
+		initDistributedAttribute(elementSize, IndexedModel::FORMAT_FLOAT,
+				instancedMode, attribute);
 	}
 }
 
 void VertexArray::initSharedBuffers(uint32 numVertexComponents,
-		const float** vertexData, uint32 numVertices,
-		const uint32* vertexElementSizes, uint32 numInstanceComponents,
+		const float* const* vertexData, uint32 numVertices,
+		const uint32* vertexElementSizes, const uint32* vertexElementFormats,
+		uint32 numInstanceComponents,
 		const uint32* instanceElementSizes, uint32 instanceDataSize,
 		uint32 instanceBufferSize, bool writeVertexComponents) {
 	uint32 attribute = 0;
@@ -334,7 +356,8 @@ void VertexArray::initSharedBuffers(uint32 numVertexComponents,
 
 		bufferSizes[i] = dataSize;
 
-		initDistributedAttribute(elementSize, false, attribute);
+		initDistributedAttribute(elementSize, vertexElementFormats[i], false,
+				attribute);
 	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, buffers[numVertexComponents]);
@@ -345,7 +368,35 @@ void VertexArray::initSharedBuffers(uint32 numVertexComponents,
 }
 
 inline void VertexArray::initDistributedAttribute(uint32 elementSize,
-		bool instancedMode, uint32& attribute) {
+		uint32 format, bool instancedMode, uint32& attribute) {
+	if (format != IndexedModel::FORMAT_FLOAT) {
+		// packed elements are always a single 4 component attribute
+		glEnableVertexAttribArray(attribute);
+
+		switch (format) {
+			case IndexedModel::FORMAT_UBYTE4:
+				glVertexAttribIPointer(attribute, 4, GL_UNSIGNED_BYTE,
+						elementSize * sizeof(float), nullptr);
+				break;
+			case IndexedModel::FORMAT_UBYTE4_NORM:
+				glVertexAttribPointer(attribute, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+						elementSize * sizeof(float), nullptr);
+				break;
+			case IndexedModel::FORMAT_USHORT4:
+				glVertexAttribIPointer(attribute, 4, GL_UNSIGNED_SHORT,
+						elementSize * sizeof(float), nullptr);
+				break;
+		}
+
+		if (instancedMode) {
+			glVertexAttribDivisor(attribute, 1);
+		}
+
+		++attribute;
+
+		return;
+	}
+
 	const uint32 elementSizeDiv = elementSize / 4;
 	const uint32 elementSizeRem = elementSize % 4;
 
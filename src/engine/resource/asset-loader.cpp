@@ -6,6 +6,9 @@
 
 #include <engine/math/math.hpp>
 
+// channels of nodes named with this prefix mark events instead of moving bones
+#define EVENT_NODE_PREFIX "event_"
+
 namespace {
 	struct VertexBoneData {
 		uint32 vertexIDs[Rig::MAX_WEIGHTS] = {0};
@@ -13,17 +16,17 @@ namespace {
 	};
 
 	void initStaticMesh(IndexedModel& newModel, const aiMesh* mesh);
-	void initRiggedMesh(IndexedModel& newModel, const aiMesh* mesh, Rig& rig);
+	void initRiggedMesh(IndexedModel& newModel, const aiMesh* mesh, Rig& rig,
+			const aiNode* rootNode);
 
 	void loadBones(Rig& rig, const aiMesh* mesh, ArrayList<VertexBoneData>& bones);
+	uint32 packBoneWeights(const float* weights);
 	void calcRigHierarchy(Rig& rig, const aiNode* rootNode);
 
+	double getTicksPerSecond(const aiAnimation* anim);
 	bool initAnimation(Animation& newAnim, const aiAnimation* anim);
 };
 
-#define HASH_TIME(time) \
-	static_cast<int32>(1e4 * (time))
-
 bool AssetLoader::loadAssets(const StringView& fileName, ArrayList<IndexedModel>& models,
 		ArrayList<Rig>& rigs, ArrayList<Animation>& animations) {
 	Assimp::Importer importer;
@@ -38,6 +41,8 @@ bool AssetLoader::loadAssets(const StringView& fileName, ArrayList<IndexedModel>
 		return false;
 	}
 
+	const size_t firstRig = rigs.size();
+
 	const Matrix4f globalInverseTransform = Math::rotate(Matrix4f(1.f), MATH_HALF_PI, Vector3f(-1.f, 0.f, 0.f));
 
 	if (scene->HasMeshes()) {
@@ -49,10 +54,7 @@ bool AssetLoader::loadAssets(const StringView& fileName, ArrayList<IndexedModel>
 				rigs.emplace_back(globalInverseTransform);
 				auto& rig = rigs.back();
 
-				::initRiggedMesh(newModel, mesh, rig);
-				::calcRigHierarchy(rig, scene->mRootNode);
-
-				rig.calcRootBone();
+				::initRiggedMesh(newModel, mesh, rig, scene->mRootNode);
 			}
 			else {
 				::initStaticMesh(newModel, mesh);
@@ -65,19 +67,35 @@ bool AssetLoader::loadAssets(const StringView& fileName, ArrayList<IndexedModel>
 						face.mIndices[1], face.mIndices[2]);
 			}
 
+			newModel.calcBounds();
+
 			models.push_back(newModel);
 		}
 	}
 
 	if (scene->HasAnimations()) {
 		for (uint32 i = 0; i < scene->mNumAnimations; ++i) {
-			animations.emplace_back(String(scene->mAnimations[i]->mName.data));
+			const aiAnimation* anim = scene->mAnimations[i];
+
+			animations.emplace_back(String(anim->mName.data),
+					static_cast<float>(anim->mDuration / ::getTicksPerSecond(anim)));
 
-			if (!initAnimation(animations.back(), scene->mAnimations[i])) {
+			if (!initAnimation(animations.back(), anim)) {
 				DEBUG_LOG("Animation Loader", LOG_ERROR,  "Animation load failed!: %s - %s",
-						fileName.data(), scene->mAnimations[i]->mName.C_Str());
+						fileName.data(), anim->mName.C_Str());
 				return false;
 			}
+
+			// animations are bound to the first rig in the same file, files
+			// holding only animations have to be resolved by the caller
+			if (rigs.size() > firstRig) {
+				animations.back().resolve(rigs[firstRig]);
+
+				// the first bone is the top of the sorted hierarchy
+				if (rigs[firstRig].getNumBones() > 0) {
+					animations.back().extractRootMotion(0);
+				}
+			}
 		}
 	}
 
@@ -106,16 +124,22 @@ namespace {
 		}
 	}
 
-	void initRiggedMesh(IndexedModel& newModel, const aiMesh* mesh, Rig& rig) {
+	void initRiggedMesh(IndexedModel& newModel, const aiMesh* mesh, Rig& rig,
+			const aiNode* rootNode) {
 		const aiVector3D aiZeroVector(0.f, 0.f, 0.f);
 
-
 		ArrayList<VertexBoneData> bones;
 		bones.resize(mesh->mNumVertices);
 
 		::loadBones(rig, mesh, bones);
+		::calcRigHierarchy(rig, rootNode);
 
-		newModel.initRiggedMesh();
+		// the vertex data is written with the sorted bone indices
+		ArrayList<uint32> boneRemap;
+		rig.sortBones(boneRemap);
+
+		const bool wideJointIndices = rig.getNumBones() > 256;
+		newModel.initRiggedMesh(wideJointIndices);
 
 		for (uint32 i = 0; i < mesh->mNumVertices; ++i) {
 			const aiVector3D pos = mesh->mVertices[i];
@@ -134,20 +158,76 @@ namespace {
 			newModel.addElement3f(3, tangent.x, tangent.y, tangent.z);
 			newModel.addElement3f(4, biTangent.x, biTangent.y, biTangent.z);
 
-			newModel.addElement3f(5, vertexIDs[0], vertexIDs[1], vertexIDs[2]);
-			newModel.addElement3f(6, weights[0], weights[1], weights[2]);
+			uint32 joints[Rig::MAX_WEIGHTS];
+
+			for (uint32 j = 0; j < Rig::MAX_WEIGHTS; ++j) {
+				joints[j] = boneRemap.empty() ? 0 : boneRemap[vertexIDs[j]];
+			}
+
+			if (wideJointIndices) {
+				newModel.addElementWord(5, joints[0] | (joints[1] << 16));
+				newModel.addElementWord(5, joints[2] | (joints[3] << 16));
+			}
+			else {
+				newModel.addElementWord(5, joints[0] | (joints[1] << 8)
+						| (joints[2] << 16) | (joints[3] << 24));
+			}
+
+			newModel.addElementWord(6, ::packBoneWeights(weights));
 		}
 	}
 
+	// keeps the largest influences when a vertex has more than MAX_WEIGHTS
 	void addBoneData(VertexBoneData& vbd, uint32 boneIndex, float weight) {
+		uint32 smallest = 0;
+
+		for (uint32 i = 1; i < Rig::MAX_WEIGHTS; ++i) {
+			if (vbd.weights[i] < vbd.weights[smallest]) {
+				smallest = i;
+			}
+		}
+
+		if (weight > vbd.weights[smallest]) {
+			vbd.vertexIDs[smallest] = boneIndex;
+			vbd.weights[smallest] = weight;
+		}
+	}
+
+	// Quantizes the weights to 8 bits each, renormalized so that they still
+	// sum to exactly 255. Rounding leftovers go to the largest weight.
+	uint32 packBoneWeights(const float* weights) {
+		float sum = 0.f;
+		uint32 largest = 0;
+
 		for (uint32 i = 0; i < Rig::MAX_WEIGHTS; ++i) {
-			if (vbd.weights[i] == 0.f) {
-				vbd.vertexIDs[i] = boneIndex;
-				vbd.weights[i] = weight;
+			sum += weights[i];
 
-				return;
+			if (weights[i] > weights[largest]) {
+				largest = i;
 			}
 		}
+
+		if (sum <= 0.f) {
+			return 255;
+		}
+
+		int32 quantized[Rig::MAX_WEIGHTS];
+		int32 total = 0;
+
+		for (uint32 i = 0; i < Rig::MAX_WEIGHTS; ++i) {
+			quantized[i] = static_cast<int32>(weights[i] / sum * 255.f + 0.5f);
+			total += quantized[i];
+		}
+
+		quantized[largest] += 255 - total;
+
+		uint32 packed = 0;
+
+		for (uint32 i = 0; i < Rig::MAX_WEIGHTS; ++i) {
+			packed |= static_cast<uint32>(quantized[i]) << (8 * i);
+		}
+
+		return packed;
 	}
 
 	void convertVec3(Vector3f& dest, const aiVector3D& src) {
@@ -214,60 +294,59 @@ namespace {
 		}
 	}
 
+	// files that leave the tick rate unset use Assimp's default of 25
+	double getTicksPerSecond(const aiAnimation* anim) {
+		return anim->mTicksPerSecond != 0.0 ? anim->mTicksPerSecond : 25.0;
+	}
+
 	bool initAnimation(Animation& newAnim, const aiAnimation* anim) {
-		HashMap<int32, KeyFrame> keyFrames;
+		const double ticksPerSecond = ::getTicksPerSecond(anim);
+
+		const uint32 eventPrefixLength = sizeof(EVENT_NODE_PREFIX) - 1;
 
 		for (uint32 i = 0; i < anim->mNumChannels; ++i) {
 			const auto* channel = anim->mChannels[i];
-			const String boneName(channel->mNodeName.data);
+			String nodeName(channel->mNodeName.data);
 
-			/*if (channel->mNumPositionKeys != channel->mNumRotationKeys
-					|| channel->mNumScalingKeys != channel->mNumRotationKeys
-					|| channel->mNumPositionKeys != channel->mNumScalingKeys) {
-				DEBUG_LOG("Animation Loader", LOG_ERROR, "Animation load error - non-equivalent amount of keys");
-				return false;
-			}*/
+			// every position key of an event node is one occurrence of the event
+			if (nodeName.starts_with(EVENT_NODE_PREFIX)) {
+				const String eventName = nodeName.substr(eventPrefixLength);
 
-			for (uint32 j = 0; j < channel->mNumRotationKeys; ++j) {
-				float time = channel->mRotationKeys[j].mTime;
-
-				/*if (!epsilonEq(time - channel->mPositionKeys[j].mTime)
-						|| !epsilonEq(time - channel->mScalingKeys[j].mTime)) {
-					return false;
-				}*/
+				for (uint32 j = 0; j < channel->mNumPositionKeys; ++j) {
+					newAnim.addEvent(eventName, static_cast<float>(
+							channel->mPositionKeys[j].mTime / ticksPerSecond));
+				}
 
-				time /= anim->mTicksPerSecond;
+				continue;
+			}
 
-				auto frame = keyFrames.find(HASH_TIME(time));
+			BoneTrack track(nodeName);
 
-				if (frame == keyFrames.end()) {
-					KeyFrame keyFrame(time);
+			track.positionTimes.resize(channel->mNumPositionKeys);
+			track.positions.resize(channel->mNumPositionKeys);
 
-					Vector3f pos, scale;
-					Quaternion rot;
+			for (uint32 j = 0; j < channel->mNumPositionKeys; ++j) {
+				track.positionTimes[j] = channel->mPositionKeys[j].mTime / ticksPerSecond;
+				::convertVec3(track.positions[j], channel->mPositionKeys[j].mValue);
+			}
 
-					::convertVec3(pos, channel->mPositionKeys[j].mValue);
-					::convertQuat(rot, channel->mRotationKeys[j].mValue);
-					::convertVec3(scale, channel->mScalingKeys[j].mValue);
+			track.rotationTimes.resize(channel->mNumRotationKeys);
+			track.rotations.resize(channel->mNumRotationKeys);
 
-					keyFrame.addBoneTransform(boneName, Transform(pos, rot, scale));
-					keyFrames.emplace(HASH_TIME(time), keyFrame); // TODO: see if some kind of move operation is faster
-				}
-				else {
-					Vector3f pos, scale;
-					Quaternion rot;
+			for (uint32 j = 0; j < channel->mNumRotationKeys; ++j) {
+				track.rotationTimes[j] = channel->mRotationKeys[j].mTime / ticksPerSecond;
+				::convertQuat(track.rotations[j], channel->mRotationKeys[j].mValue);
+			}
 
-					::convertVec3(pos, channel->mPositionKeys[j].mValue);
-					::convertQuat(rot, channel->mRotationKeys[j].mValue);
-					::convertVec3(scale, channel->mScalingKeys[j].mValue);
+			track.scaleTimes.resize(channel->mNumScalingKeys);
+			track.scales.resize(channel->mNumScalingKeys);
 
-					frame->second.addBoneTransform(boneName, Transform(pos, rot, scale));
-				}
+			for (uint32 j = 0; j < channel->mNumScalingKeys; ++j) {
+				track.scaleTimes[j] = channel->mScalingKeys[j].mTime / ticksPerSecond;
+				::convertVec3(track.scales[j], channel->mScalingKeys[j].mValue);
 			}
-		}
 
-		for (auto& pair : keyFrames) {
-			newAnim.addKeyFrame(pair.second);
+			newAnim.addTrack(std::move(track));
 		}
 
 		return true;
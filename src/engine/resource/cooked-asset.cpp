@@ -0,0 +1,799 @@
+#include "engine/resource/cooked-asset.hpp"
+
+#include <engine/resource/asset-loader.hpp>
+
+#include <engine/core/memory.hpp>
+
+#include <cstdio>
+#include <type_traits>
+
+#define COOKED_ASSET_MAGIC 0x4B4F4F43 // "COOK"
+#define COOKED_ASSET_VERSION 2
+#define COOKED_ASSET_ALIGNMENT 16
+
+namespace {
+	// offsets are from the start of the file, counts are in elements
+	struct ArrayRecord {
+		uint64 offset;
+		uint64 count;
+	};
+
+	struct FileHeader {
+		uint32 magic;
+		uint32 version;
+
+		ArrayRecord models;
+		ArrayRecord rigs;
+		ArrayRecord animations;
+	};
+
+	struct ModelRecord {
+		uint32 numVertices;
+		uint32 instancedElementStartIndex;
+		uint32 flags;
+		uint32 boundsValid;
+
+		float aabb[6];
+		float boundingSphere[4];
+
+		ArrayRecord indices;
+		ArrayRecord elementSizes;
+		ArrayRecord elementFormats;
+		ArrayRecord elements; // ArrayRecord of the data of every element
+	};
+
+	struct BoneRecord {
+		float localTransform[16];
+		int32 parent;
+		uint32 padding;
+
+		ArrayRecord name;
+	};
+
+	struct RigRecord {
+		float globalInverseTransform[16];
+		ArrayRecord bones;
+	};
+
+	struct TrackRecord {
+		ArrayRecord boneName;
+
+		ArrayRecord positionTimes;
+		ArrayRecord positions;
+
+		ArrayRecord rotationTimes;
+		ArrayRecord rotations;
+
+		ArrayRecord scaleTimes;
+		ArrayRecord scales;
+	};
+
+	struct EventRecord {
+		float time;
+		uint32 padding;
+
+		ArrayRecord name;
+	};
+
+	// Animation::CompressedKeys, the channel times are uint16 when
+	// quantizedTimes is set and float otherwise
+	struct CompressedKeysRecord {
+		float timeScale;
+		uint32 quantizedTimes;
+
+		ArrayRecord positionCurves;
+		ArrayRecord rotationCurves;
+		ArrayRecord scaleCurves;
+
+		ArrayRecord positionRanges;
+		ArrayRecord scaleRanges;
+
+		ArrayRecord positionTimes;
+		ArrayRecord rotationTimes;
+		ArrayRecord scaleTimes;
+
+		ArrayRecord positions;
+		ArrayRecord rotations;
+		ArrayRecord scales;
+
+		ArrayRecord rootPositionTimes;
+		ArrayRecord rootPositions;
+
+		ArrayRecord rootRotationTimes;
+		ArrayRecord rootRotations;
+	};
+
+	struct AnimationRecord {
+		ArrayRecord name;
+
+		float duration;
+		int32 rig; // index in the file's rigs, -1 for unresolved tracks
+		int32 rootMotionBone;
+		uint32 compressed; // keys instead of tracks
+
+		ArrayRecord tracks;
+		ArrayRecord events;
+		ArrayRecord keys; // one CompressedKeysRecord if compressed
+	};
+
+	class CookedWriter {
+		public:
+			inline CookedWriter() : data(sizeof(FileHeader)) {}
+
+			template <typename T>
+			ArrayRecord write(const T* values, uint64 count) {
+				static_assert(std::is_trivially_copyable_v<T>);
+
+				const uint64 offset = (data.size() + COOKED_ASSET_ALIGNMENT - 1)
+						& ~static_cast<uint64>(COOKED_ASSET_ALIGNMENT - 1);
+
+				data.resize(offset + count * sizeof(T));
+
+				if (count > 0) {
+					Memory::memcpy(&data[offset], values, count * sizeof(T));
+				}
+
+				return {offset, count};
+			}
+
+			template <typename T>
+			inline ArrayRecord write(const ArrayList<T>& values) {
+				return write(values.data(), values.size());
+			}
+
+			inline ArrayRecord write(const String& str) {
+				return write(str.data(), str.size());
+			}
+
+			bool save(const StringView& fileName, const FileHeader& header);
+		private:
+			ArrayList<uint8> data;
+	};
+
+	// bounds and alignment checked access to a mapped file
+	class CookedReader {
+		public:
+			inline CookedReader(const uint8* data, uintptr size)
+					: data(data)
+					, size(size) {}
+
+			template <typename T>
+			const T* get(const ArrayRecord& record) const {
+				if (record.count == 0) {
+					return nullptr;
+				}
+
+				if (record.offset % alignof(T) != 0 || record.offset > size
+						|| record.count > (size - record.offset) / sizeof(T)) {
+					return nullptr;
+				}
+
+				return reinterpret_cast<const T*>(data + record.offset);
+			}
+
+			template <typename T>
+			inline bool isValid(const ArrayRecord& record) const {
+				return record.count == 0 || get<T>(record) != nullptr;
+			}
+
+			inline String getString(const ArrayRecord& record) const {
+				const char* str = get<char>(record);
+				return str ? String(str, record.count) : String();
+			}
+		private:
+			const uint8* data;
+			uintptr size;
+	};
+
+	void copyMatrix(float* dest, const Matrix4f& src);
+	Matrix4f toMatrix(const float* src);
+
+	TrackRecord writeTrack(CookedWriter& writer, const BoneTrack& track);
+	BoneTrack readTrack(const CookedReader& reader, const TrackRecord& record);
+
+	CompressedKeysRecord writeCompressedKeys(CookedWriter& writer,
+			const Animation::CompressedKeys& keys);
+	Animation::CompressedKeys readCompressedKeys(const CookedReader& reader,
+			const CompressedKeysRecord& record);
+	bool validateCompressedKeys(const CookedReader& reader,
+			const CompressedKeysRecord& record, uint64 numBones);
+
+	template <typename T>
+	inline void readArray(const CookedReader& reader, const ArrayRecord& record,
+			ArrayList<T>& values) {
+		const T* data = reader.get<T>(record);
+		values.assign(data, data + record.count);
+	}
+};
+
+bool CookedAsset::write(const StringView& fileName, const ArrayList<IndexedModel>& models,
+		const ArrayList<Rig>& rigs, const ArrayList<Animation>& animations) {
+	CookedWriter writer;
+
+	ArrayList<ModelRecord> modelRecords;
+
+	for (const IndexedModel& model : models) {
+		const IndexedModelView view = model.getView();
+		const uint32 numElements = view.elements.size();
+
+		ModelRecord record = {};
+		record.numVertices = view.numVertices;
+		record.instancedElementStartIndex = view.instancedElementStartIndex;
+		record.flags = view.flags;
+		record.boundsValid = view.boundsValid;
+
+		if (view.boundsValid) {
+			const Vector3f minExtents = view.aabb.getMinExtents();
+			const Vector3f maxExtents = view.aabb.getMaxExtents();
+			const Vector3f center = view.boundingSphere.getCenter();
+
+			Memory::memcpy(record.aabb, &minExtents, sizeof(Vector3f));
+			Memory::memcpy(record.aabb + 3, &maxExtents, sizeof(Vector3f));
+			Memory::memcpy(record.boundingSphere, &center, sizeof(Vector3f));
+			record.boundingSphere[3] = view.boundingSphere.getRadius();
+		}
+
+		record.indices = writer.write(view.indices, view.numIndices);
+		record.elementSizes = writer.write(view.elementSizes, numElements);
+		record.elementFormats = writer.write(view.elementFormats, numElements);
+
+		ArrayList<ArrayRecord> elementRecords(numElements, ArrayRecord{0, 0});
+
+		for (uint32 i = 0; i < view.getNumVertexComponents(); ++i) {
+			elementRecords[i] = writer.write(view.elements[i],
+					static_cast<uint64>(view.elementSizes[i]) * view.numVertices);
+		}
+
+		record.elements = writer.write(elementRecords);
+		modelRecords.push_back(record);
+	}
+
+	ArrayList<RigRecord> rigRecords;
+
+	for (const Rig& rig : rigs) {
+		ArrayList<BoneRecord> boneRecords;
+
+		for (uint32 i = 0; i < rig.getNumBones(); ++i) {
+			const Bone& bone = rig.getBone(i);
+
+			BoneRecord boneRecord = {};
+			::copyMatrix(boneRecord.localTransform, bone.localTransform);
+			boneRecord.parent = bone.parent;
+			boneRecord.name = writer.write(bone.name);
+
+			boneRecords.push_back(boneRecord);
+		}
+
+		RigRecord record = {};
+		::copyMatrix(record.globalInverseTransform, rig.getGlobalInverseTransform());
+		record.bones = writer.write(boneRecords);
+
+		rigRecords.push_back(record);
+	}
+
+	ArrayList<AnimationRecord> animationRecords;
+
+	for (const Animation& animation : animations) {
+		if (animation.isResolved() && (rigs.empty()
+				|| animation.getNumBones() != rigs[0].getNumBones())) {
+			DEBUG_LOG("Cooked Asset", LOG_ERROR,
+					"Animation %s is not bound to the first rig",
+					animation.getName().c_str());
+			return false;
+		}
+
+		ArrayList<TrackRecord> trackRecords;
+
+		// compressed clips have no tracks to return
+		for (uint32 i = 0; i < animation.getNumTracks() && !animation.isCompressed(); ++i) {
+			BoneTrack track = animation.getTrack(i);
+
+			if (animation.isResolved()) {
+				track.boneName = rigs[0].getBone(i).name;
+			}
+
+			trackRecords.push_back(::writeTrack(writer, track));
+		}
+
+		ArrayList<EventRecord> eventRecords;
+
+		for (uint32 i = 0; i < animation.getNumEvents(); ++i) {
+			const Animation::Event& event = animation.getEvent(i);
+
+			EventRecord eventRecord = {};
+			eventRecord.time = event.time;
+			eventRecord.name = writer.write(animation.getEventName(event));
+
+			eventRecords.push_back(eventRecord);
+		}
+
+		AnimationRecord record = {};
+		record.name = writer.write(animation.getName());
+		record.duration = animation.getDuration();
+		record.rig = animation.isResolved() ? 0 : -1;
+		record.rootMotionBone = animation.getRootMotionBone();
+		record.compressed = animation.isCompressed();
+		record.tracks = writer.write(trackRecords);
+		record.events = writer.write(eventRecords);
+
+		if (animation.isCompressed()) {
+			const CompressedKeysRecord keysRecord = ::writeCompressedKeys(writer,
+					animation.getCompressedKeys());
+			record.keys = writer.write(&keysRecord, 1);
+		}
+
+		animationRecords.push_back(record);
+	}
+
+	FileHeader header = {};
+	header.magic = COOKED_ASSET_MAGIC;
+	header.version = COOKED_ASSET_VERSION;
+	header.models = writer.write(modelRecords);
+	header.rigs = writer.write(rigRecords);
+	header.animations = writer.write(animationRecords);
+
+	return writer.save(fileName, header);
+}
+
+bool CookedAsset::cook(const StringView& sourceFileName,
+		const StringView& cookedFileName,
+		const Animation::CompressionSettings* compression) {
+	ArrayList<IndexedModel> models;
+	ArrayList<Rig> rigs;
+	ArrayList<Animation> animations;
+
+	if (!AssetLoader::loadAssets(sourceFileName, models, rigs, animations)) {
+		return false;
+	}
+
+	if (compression) {
+		// unresolved clips have no curves to compress and are written as is
+		for (Animation& animation : animations) {
+			animation.compress(*compression);
+		}
+	}
+
+	return write(cookedFileName, models, rigs, animations);
+}
+
+bool CookedAssetFile::open(const StringView& fileName) {
+	close();
+
+	if (!file.open(fileName)) {
+		return false;
+	}
+
+	const CookedReader reader(file.getData(), file.getSize());
+	header = reader.get<FileHeader>({0, 1});
+
+	if (!header || !validate()) {
+		DEBUG_LOG("Cooked Asset", LOG_ERROR, "Invalid cooked asset file: %s",
+				fileName.data());
+
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void CookedAssetFile::close() {
+	file.close();
+	header = nullptr;
+}
+
+uint32 CookedAssetFile::getNumModels() const {
+	return static_cast<const FileHeader*>(header)->models.count;
+}
+
+IndexedModelView CookedAssetFile::getModel(uint32 i) const {
+	const CookedReader reader(file.getData(), file.getSize());
+	const ModelRecord& record = reader.get<ModelRecord>(
+			static_cast<const FileHeader*>(header)->models)[i];
+	const ArrayRecord* elements = reader.get<ArrayRecord>(record.elements);
+
+	IndexedModelView view;
+	view.elements.resize(record.elements.count);
+
+	for (uint32 j = 0; j < record.elements.count; ++j) {
+		view.elements[j] = reader.get<float>(elements[j]);
+	}
+
+	view.elementSizes = reader.get<uint32>(record.elementSizes);
+	view.elementFormats = reader.get<uint32>(record.elementFormats);
+	view.indices = reader.get<uint32>(record.indices);
+
+	view.numVertices = record.numVertices;
+	view.numIndices = record.indices.count;
+	view.instancedElementStartIndex = record.instancedElementStartIndex;
+	view.flags = record.flags;
+
+	view.boundsValid = record.boundsValid != 0;
+
+	if (view.boundsValid) {
+		view.aabb = AABB(Vector3f(record.aabb[0], record.aabb[1], record.aabb[2]),
+				Vector3f(record.aabb[3], record.aabb[4], record.aabb[5]));
+		view.boundingSphere = Sphere(Vector3f(record.boundingSphere[0],
+				record.boundingSphere[1], record.boundingSphere[2]),
+				record.boundingSphere[3]);
+	}
+
+	return view;
+}
+
+void CookedAssetFile::loadRigsAndAnimations(ArrayList<Rig>& rigs,
+		ArrayList<Animation>& animations) const {
+	const CookedReader reader(file.getData(), file.getSize());
+	const FileHeader& fileHeader = *static_cast<const FileHeader*>(header);
+
+	const size_t firstRig = rigs.size();
+	const RigRecord* rigRecords = reader.get<RigRecord>(fileHeader.rigs);
+
+	for (uint32 i = 0; i < fileHeader.rigs.count; ++i) {
+		const RigRecord& record = rigRecords[i];
+		const BoneRecord* bones = reader.get<BoneRecord>(record.bones);
+
+		rigs.emplace_back(::toMatrix(record.globalInverseTransform));
+		Rig& rig = rigs.back();
+
+		// bones were written parent first, so every parent is already added
+		for (uint32 j = 0; j < record.bones.count; ++j) {
+			const String name = reader.getString(bones[j].name);
+			rig.addBone(name, ::toMatrix(bones[j].localTransform));
+
+			if (bones[j].parent >= 0) {
+				rig.setBoneParent(rig.getBone(bones[j].parent).name, name);
+			}
+		}
+
+		rig.resetBones();
+	}
+
+	const AnimationRecord* animationRecords
+			= reader.get<AnimationRecord>(fileHeader.animations);
+
+	for (uint32 i = 0; i < fileHeader.animations.count; ++i) {
+		const AnimationRecord& record = animationRecords[i];
+		const TrackRecord* tracks = reader.get<TrackRecord>(record.tracks);
+		const EventRecord* events = reader.get<EventRecord>(record.events);
+
+		animations.emplace_back(reader.getString(record.name), record.duration);
+		Animation& animation = animations.back();
+
+		for (uint32 j = 0; j < record.tracks.count; ++j) {
+			animation.addTrack(::readTrack(reader, tracks[j]));
+		}
+
+		for (uint32 j = 0; j < record.events.count; ++j) {
+			animation.addEvent(reader.getString(events[j].name), events[j].time);
+		}
+
+		if (record.compressed) {
+			Animation::CompressedKeys keys = ::readCompressedKeys(reader,
+					*reader.get<CompressedKeysRecord>(record.keys));
+			keys.rootMotionBone = record.rootMotionBone;
+
+			animation.setCompressedKeys(rigs[firstRig + record.rig].getNumBones(),
+					std::move(keys));
+		}
+		else if (record.rig >= 0) {
+			animation.resolve(rigs[firstRig + record.rig]);
+
+			if (record.rootMotionBone >= 0) {
+				animation.extractRootMotion(record.rootMotionBone);
+			}
+		}
+	}
+}
+
+bool CookedAssetFile::validate() const {
+	const CookedReader reader(file.getData(), file.getSize());
+	const FileHeader& fileHeader = *static_cast<const FileHeader*>(header);
+
+	if (fileHeader.magic != COOKED_ASSET_MAGIC
+			|| fileHeader.version != COOKED_ASSET_VERSION) {
+		return false;
+	}
+
+	if (!reader.isValid<ModelRecord>(fileHeader.models)
+			|| !reader.isValid<RigRecord>(fileHeader.rigs)
+			|| !reader.isValid<AnimationRecord>(fileHeader.animations)) {
+		return false;
+	}
+
+	const ModelRecord* models = reader.get<ModelRecord>(fileHeader.models);
+
+	for (uint32 i = 0; i < fileHeader.models.count; ++i) {
+		const ModelRecord& model = models[i];
+		const uint64 numElements = model.elements.count;
+
+		if (model.elementSizes.count != numElements
+				|| model.elementFormats.count != numElements
+				|| !reader.isValid<uint32>(model.indices)
+				|| !reader.isValid<uint32>(model.elementSizes)
+				|| !reader.isValid<uint32>(model.elementFormats)
+				|| !reader.isValid<ArrayRecord>(model.elements)) {
+			return false;
+		}
+
+		const uint32* sizes = reader.get<uint32>(model.elementSizes);
+		const ArrayRecord* elements = reader.get<ArrayRecord>(model.elements);
+		const uint64 numVertexElements = model.instancedElementStartIndex < numElements
+				? model.instancedElementStartIndex : numElements;
+
+		for (uint32 j = 0; j < numVertexElements; ++j) {
+			if (elements[j].count != static_cast<uint64>(sizes[j]) * model.numVertices
+					|| !reader.isValid<float>(elements[j])) {
+				return false;
+			}
+		}
+	}
+
+	const RigRecord* rigs = reader.get<RigRecord>(fileHeader.rigs);
+
+	for (uint32 i = 0; i < fileHeader.rigs.count; ++i) {
+		if (!reader.isValid<BoneRecord>(rigs[i].bones)) {
+			return false;
+		}
+
+		const BoneRecord* bones = reader.get<BoneRecord>(rigs[i].bones);
+
+		for (uint32 j = 0; j < rigs[i].bones.count; ++j) {
+			if (bones[j].parent >= static_cast<int32>(j)
+					|| !reader.isValid<char>(bones[j].name)) {
+				return false;
+			}
+		}
+	}
+
+	const AnimationRecord* animations = reader.get<AnimationRecord>(fileHeader.animations);
+
+	for (uint32 i = 0; i < fileHeader.animations.count; ++i) {
+		const AnimationRecord& animation = animations[i];
+
+		if (animation.rig < -1 || animation.rig >= static_cast<int32>(fileHeader.rigs.count)) {
+			return false;
+		}
+
+		// root motion is extracted from the resolved clip, so the bone has to
+		// exist in its rig
+		if (animation.rootMotionBone < -1 || (animation.rootMotionBone >= 0
+				&& (animation.rig < 0 || static_cast<uint64>(animation.rootMotionBone)
+				>= rigs[animation.rig].bones.count))) {
+			return false;
+		}
+
+		if (!reader.isValid<char>(animation.name)
+				|| !reader.isValid<TrackRecord>(animation.tracks)
+				|| !reader.isValid<EventRecord>(animation.events)) {
+			return false;
+		}
+
+		// compressed keys are bound to their rig and replace the tracks
+		if (animation.compressed && (animation.rig < 0 || animation.tracks.count != 0
+				|| animation.keys.count != 1
+				|| !reader.isValid<CompressedKeysRecord>(animation.keys)
+				|| !::validateCompressedKeys(reader,
+				*reader.get<CompressedKeysRecord>(animation.keys),
+				rigs[animation.rig].bones.count))) {
+			return false;
+		}
+
+		const TrackRecord* tracks = reader.get<TrackRecord>(animation.tracks);
+
+		for (uint32 j = 0; j < animation.tracks.count; ++j) {
+			const TrackRecord& track = tracks[j];
+
+			if (!reader.isValid<char>(track.boneName)
+					|| track.positionTimes.count != track.positions.count
+					|| track.rotationTimes.count != track.rotations.count
+					|| track.scaleTimes.count != track.scales.count
+					|| !reader.isValid<float>(track.positionTimes)
+					|| !reader.isValid<Vector3f>(track.positions)
+					|| !reader.isValid<float>(track.rotationTimes)
+					|| !reader.isValid<Quaternion>(track.rotations)
+					|| !reader.isValid<float>(track.scaleTimes)
+					|| !reader.isValid<Vector3f>(track.scales)) {
+				return false;
+			}
+		}
+
+		const EventRecord* events = reader.get<EventRecord>(animation.events);
+
+		for (uint32 j = 0; j < animation.events.count; ++j) {
+			if (!reader.isValid<char>(events[j].name)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+namespace {
+	bool CookedWriter::save(const StringView& fileName, const FileHeader& header) {
+		Memory::memcpy(data.data(), &header, sizeof(FileHeader));
+
+		const String name(fileName.data(), fileName.size());
+		FILE* file = fopen(name.c_str(), "wb");
+
+		if (!file) {
+			DEBUG_LOG("Cooked Asset", LOG_ERROR, "Failed to open %s for writing",
+					name.c_str());
+			return false;
+		}
+
+		const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+		fclose(file);
+
+		return written;
+	}
+
+	void copyMatrix(float* dest, const Matrix4f& src) {
+		Memory::memcpy(dest, &src[0][0], 16 * sizeof(float));
+	}
+
+	Matrix4f toMatrix(const float* src) {
+		Matrix4f m;
+		Memory::memcpy(&m[0][0], src, 16 * sizeof(float));
+
+		return m;
+	}
+
+	TrackRecord writeTrack(CookedWriter& writer, const BoneTrack& track) {
+		TrackRecord record;
+		record.boneName = writer.write(track.boneName);
+
+		record.positionTimes = writer.write(track.positionTimes);
+		record.positions = writer.write(track.positions);
+
+		record.rotationTimes = writer.write(track.rotationTimes);
+		record.rotations = writer.write(track.rotations);
+
+		record.scaleTimes = writer.write(track.scaleTimes);
+		record.scales = writer.write(track.scales);
+
+		return record;
+	}
+
+	BoneTrack readTrack(const CookedReader& reader, const TrackRecord& record) {
+		BoneTrack track(reader.getString(record.boneName));
+
+		const float* positionTimes = reader.get<float>(record.positionTimes);
+		const Vector3f* positions = reader.get<Vector3f>(record.positions);
+		track.positionTimes.assign(positionTimes, positionTimes + record.positionTimes.count);
+		track.positions.assign(positions, positions + record.positions.count);
+
+		const float* rotationTimes = reader.get<float>(record.rotationTimes);
+		const Quaternion* rotations = reader.get<Quaternion>(record.rotations);
+		track.rotationTimes.assign(rotationTimes, rotationTimes + record.rotationTimes.count);
+		track.rotations.assign(rotations, rotations + record.rotations.count);
+
+		const float* scaleTimes = reader.get<float>(record.scaleTimes);
+		const Vector3f* scales = reader.get<Vector3f>(record.scales);
+		track.scaleTimes.assign(scaleTimes, scaleTimes + record.scaleTimes.count);
+		track.scales.assign(scales, scales + record.scales.count);
+
+		return track;
+	}
+
+	CompressedKeysRecord writeCompressedKeys(CookedWriter& writer,
+			const Animation::CompressedKeys& keys) {
+		CompressedKeysRecord record;
+		record.timeScale = keys.timeScale;
+		record.quantizedTimes = keys.quantizedTimes;
+
+		record.positionCurves = writer.write(keys.positionCurves);
+		record.rotationCurves = writer.write(keys.rotationCurves);
+		record.scaleCurves = writer.write(keys.scaleCurves);
+
+		record.positionRanges = writer.write(keys.positionRanges);
+		record.scaleRanges = writer.write(keys.scaleRanges);
+
+		if (keys.quantizedTimes) {
+			record.positionTimes = writer.write(keys.quantizedPositionTimes);
+			record.rotationTimes = writer.write(keys.quantizedRotationTimes);
+			record.scaleTimes = writer.write(keys.quantizedScaleTimes);
+		}
+		else {
+			record.positionTimes = writer.write(keys.positionTimes);
+			record.rotationTimes = writer.write(keys.rotationTimes);
+			record.scaleTimes = writer.write(keys.scaleTimes);
+		}
+
+		record.positions = writer.write(keys.positions);
+		record.rotations = writer.write(keys.rotations);
+		record.scales = writer.write(keys.scales);
+
+		record.rootPositionTimes = writer.write(keys.rootPositionTimes);
+		record.rootPositions = writer.write(keys.rootPositions);
+
+		record.rootRotationTimes = writer.write(keys.rootRotationTimes);
+		record.rootRotations = writer.write(keys.rootRotations);
+
+		return record;
+	}
+
+	Animation::CompressedKeys readCompressedKeys(const CookedReader& reader,
+			const CompressedKeysRecord& record) {
+		Animation::CompressedKeys keys;
+		keys.timeScale = record.timeScale;
+		keys.quantizedTimes = record.quantizedTimes != 0;
+
+		::readArray(reader, record.positionCurves, keys.positionCurves);
+		::readArray(reader, record.rotationCurves, keys.rotationCurves);
+		::readArray(reader, record.scaleCurves, keys.scaleCurves);
+
+		::readArray(reader, record.positionRanges, keys.positionRanges);
+		::readArray(reader, record.scaleRanges, keys.scaleRanges);
+
+		if (keys.quantizedTimes) {
+			::readArray(reader, record.positionTimes, keys.quantizedPositionTimes);
+			::readArray(reader, record.rotationTimes, keys.quantizedRotationTimes);
+			::readArray(reader, record.scaleTimes, keys.quantizedScaleTimes);
+		}
+		else {
+			::readArray(reader, record.positionTimes, keys.positionTimes);
+			::readArray(reader, record.rotationTimes, keys.rotationTimes);
+			::readArray(reader, record.scaleTimes, keys.scaleTimes);
+		}
+
+		::readArray(reader, record.positions, keys.positions);
+		::readArray(reader, record.rotations, keys.rotations);
+		::readArray(reader, record.scales, keys.scales);
+
+		::readArray(reader, record.rootPositionTimes, keys.rootPositionTimes);
+		::readArray(reader, record.rootPositions, keys.rootPositions);
+
+		::readArray(reader, record.rootRotationTimes, keys.rootRotationTimes);
+		::readArray(reader, record.rootRotations, keys.rootRotations);
+
+		return keys;
+	}
+
+	bool validateCompressedKeys(const CookedReader& reader,
+			const CompressedKeysRecord& record, uint64 numBones) {
+		// one curve per bone, each inside the channel's keys, with 3 values
+		// per key
+		const auto isValidChannel = [&](const ArrayRecord& curveRecord,
+				const ArrayRecord& times, const ArrayRecord& values) {
+			const bool timesValid = record.quantizedTimes
+					? reader.isValid<uint16>(times) : reader.isValid<float>(times);
+
+			if (curveRecord.count != numBones || !timesValid
+					|| values.count != 3 * times.count
+					|| !reader.isValid<uint16>(values)
+					|| !reader.isValid<Animation::Curve>(curveRecord)) {
+				return false;
+			}
+
+			const Animation::Curve* curves = reader.get<Animation::Curve>(curveRecord);
+
+			for (uint64 i = 0; i < curveRecord.count; ++i) {
+				if (static_cast<uint64>(curves[i].firstKey) + curves[i].numKeys
+						> times.count) {
+					return false;
+				}
+			}
+
+			return true;
+		};
+
+		return isValidChannel(record.positionCurves, record.positionTimes,
+						record.positions)
+				&& isValidChannel(record.rotationCurves, record.rotationTimes,
+						record.rotations)
+				&& isValidChannel(record.scaleCurves, record.scaleTimes,
+						record.scales)
+				&& record.positionRanges.count == numBones
+				&& record.scaleRanges.count == numBones
+				&& reader.isValid<Animation::QuantizationRange>(record.positionRanges)
+				&& reader.isValid<Animation::QuantizationRange>(record.scaleRanges)
+				&& record.rootPositionTimes.count == record.rootPositions.count
+				&& record.rootRotationTimes.count == record.rootRotations.count
+				&& reader.isValid<float>(record.rootPositionTimes)
+				&& reader.isValid<Vector3f>(record.rootPositions)
+				&& reader.isValid<float>(record.rootRotationTimes)
+				&& reader.isValid<Quaternion>(record.rootRotations);
+	}
+};